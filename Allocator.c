@@ -0,0 +1,55 @@
+#include <string.h>
+#include "Allocator.h"
+
+/**
+ * Allocates a block of the given size.
+ * @param allocator the allocator to use (NULL for malloc).
+ * @param size the size of the block.
+ * @return the allocated block, NULL for failure.
+ */
+void *AllocatorAlloc(const Allocator *allocator, size_t size){
+    if (!allocator) return malloc(size);
+    return allocator->alloc(allocator->ctx, size);
+}
+
+/**
+ * Allocates a block of the given size, set to zeros.
+ * @param allocator the allocator to use (NULL for calloc).
+ * @param size the size of the block.
+ * @return the allocated block, NULL for failure.
+ */
+void *AllocatorCalloc(const Allocator *allocator, size_t size){
+    if (!allocator) return calloc(1, size);
+    void *block = allocator->alloc(allocator->ctx, size);
+    if (block) memset(block, 0, size);
+    return block;
+}
+
+/**
+ * Resizes a block which was allocated by the same allocator.
+ * @param allocator the allocator to use (NULL for realloc).
+ * @param ptr the block to be resized.
+ * @param old_size the current size of the block.
+ * @param new_size the new size of the block.
+ * @return the resized block, NULL for failure (ptr is then still valid).
+ */
+void *AllocatorResize(const Allocator *allocator, void *ptr, size_t old_size,
+                      size_t new_size){
+    if (!allocator) return realloc(ptr, new_size);
+    return allocator->resize(allocator->ctx, ptr, old_size, new_size);
+}
+
+/**
+ * Frees a block which was allocated by the same allocator.
+ * @param allocator the allocator to use (NULL for free).
+ * @param ptr the block to be freed.
+ * @param size the size of the block.
+ */
+void AllocatorFree(const Allocator *allocator, void *ptr, size_t size){
+    if (!ptr) return;
+    if (!allocator){
+        free(ptr);
+        return;
+    }
+    allocator->release(allocator->ctx, ptr, size);
+}
@@ -0,0 +1,78 @@
+#ifndef ALLOCATOR_H_
+#define ALLOCATOR_H_
+
+#include <stdlib.h>
+
+/**
+ * @typedef AllocatorAllocFunc
+ * Function which receives the allocator context and a size, and returns
+ * a block of at least size bytes (NULL for failure).
+ */
+typedef void *(*AllocatorAllocFunc)(void *, size_t);
+
+/**
+ * @typedef AllocatorResizeFunc
+ * Function which receives the allocator context, a block, its old size and
+ * a new size, and returns a block of the new size with the old content
+ * (NULL for failure, the old block is then untouched).
+ */
+typedef void *(*AllocatorResizeFunc)(void *, void *, size_t, size_t);
+
+/**
+ * @typedef AllocatorFreeFunc
+ * Function which receives the allocator context, a block and its size,
+ * and frees the block.
+ */
+typedef void (*AllocatorFreeFunc)(void *, void *, size_t);
+
+/**
+ * @struct Allocator - a pluggable memory allocator.
+ * A NULL allocator pointer means the standard malloc, realloc and free.
+ * @param ctx the context (state) of the allocator, passed to its functions.
+ * @param alloc a function which allocates blocks.
+ * @param resize a function which resizes blocks.
+ * @param release a function which frees blocks.
+ */
+typedef struct Allocator {
+  void *ctx;
+  AllocatorAllocFunc alloc;
+  AllocatorResizeFunc resize;
+  AllocatorFreeFunc release;
+} Allocator;
+
+/**
+ * Allocates a block of the given size.
+ * @param allocator the allocator to use (NULL for malloc).
+ * @param size the size of the block.
+ * @return the allocated block, NULL for failure.
+ */
+void *AllocatorAlloc(const Allocator *allocator, size_t size);
+
+/**
+ * Allocates a block of the given size, set to zeros.
+ * @param allocator the allocator to use (NULL for calloc).
+ * @param size the size of the block.
+ * @return the allocated block, NULL for failure.
+ */
+void *AllocatorCalloc(const Allocator *allocator, size_t size);
+
+/**
+ * Resizes a block which was allocated by the same allocator.
+ * @param allocator the allocator to use (NULL for realloc).
+ * @param ptr the block to be resized.
+ * @param old_size the current size of the block.
+ * @param new_size the new size of the block.
+ * @return the resized block, NULL for failure (ptr is then still valid).
+ */
+void *AllocatorResize(const Allocator *allocator, void *ptr, size_t old_size,
+                      size_t new_size);
+
+/**
+ * Frees a block which was allocated by the same allocator.
+ * @param allocator the allocator to use (NULL for free).
+ * @param ptr the block to be freed.
+ * @param size the size of the block.
+ */
+void AllocatorFree(const Allocator *allocator, void *ptr, size_t size);
+
+#endif //ALLOCATOR_H_
@@ -0,0 +1,218 @@
+#define _POSIX_C_SOURCE 200809L
+#include <pthread.h>
+#include <string.h>
+#include "ConcurrentHashMap.h"
+#include "Hash.h"
+
+/*
+ * The segment of a key is chosen by the high bits of its hash, the HashMap of
+ * the segment uses the low bits for its buckets.
+ */
+#define SEGMENT_SHIFT (sizeof(size_t) * 8 - 16)
+#define SEGMENT_INDEX(hash) (((hash) >> SEGMENT_SHIFT) & (CONCURRENT_HASH_MAP_SEGMENTS - 1))
+
+/*
+ * Every segment starts its own cache line, so locking one segment never
+ * invalidates the lock of its neighbours (false sharing).
+ */
+#define SEGMENT_ALIGN 64UL
+#if defined(__GNUC__)
+#define SEGMENT_ALIGNED __attribute__((aligned(SEGMENT_ALIGN)))
+#else
+#define SEGMENT_ALIGNED
+#endif
+
+struct ConcurrentHashMapSegment {
+  pthread_rwlock_t lock;
+  HashMap *map;
+} SEGMENT_ALIGNED;
+
+ConcurrentHashMapSegment *GetSegment(ConcurrentHashMap *hash_map, KeyT key);
+
+/**
+ * Allocates dynamically new concurrent hash map element.
+ * The pairs stored in it must have a thread safe allocator in their PairType
+ * (NULL for malloc), not a SlabAllocator: segments copy and free pairs in
+ * parallel.
+ * @param hash_func a function which "hashes" keys.
+ * @param pair_cpy a function which copies pairs.
+ * @param pair_cmp a function which compares pairs.
+ * @param pair_free a function which frees pairs.
+ * @return pointer to dynamically allocated ConcurrentHashMap.
+ * @if_fail return NULL.
+ */
+ConcurrentHashMap *ConcurrentHashMapAlloc(HashFunc hash_func, HashMapPairCpy pair_cpy,
+        HashMapPairCmp pair_cmp, HashMapPairFree pair_free){
+    if (!hash_func || !pair_cpy || !pair_cmp || !pair_free) return NULL;
+    ConcurrentHashMap *new_hash_map = malloc(sizeof(ConcurrentHashMap));
+    if (!new_hash_map) return NULL;
+    size_t segments_size = CONCURRENT_HASH_MAP_SEGMENTS * sizeof(ConcurrentHashMapSegment);
+    void *segments = NULL;
+    if (posix_memalign(&segments, SEGMENT_ALIGN, segments_size) != 0){
+        free(new_hash_map);
+        return NULL;
+    }
+    memset(segments, 0, segments_size);
+    new_hash_map->segments = (ConcurrentHashMapSegment *) segments;
+    new_hash_map->hash_func = hash_func;
+    for (size_t i = 0; i < CONCURRENT_HASH_MAP_SEGMENTS; ++i) {
+        ConcurrentHashMapSegment *segment = &new_hash_map->segments[i];
+        segment->map = HashMapAlloc(hash_func, pair_cpy, pair_cmp, pair_free);
+        // a resize moves a few buckets per write instead of holding the
+        // write lock for a full rehash.
+        if (segment->map) HashMapSetIncrementalRehash(segment->map, 1);
+        if (!segment->map || pthread_rwlock_init(&segment->lock, NULL) != 0){
+            HashMapFree(&segment->map);
+            for (size_t j = 0; j < i; ++j) {
+                pthread_rwlock_destroy(&new_hash_map->segments[j].lock);
+                HashMapFree(&new_hash_map->segments[j].map);
+            }
+            free(new_hash_map->segments);
+            free(new_hash_map);
+            return NULL;
+        }
+    }
+    return new_hash_map;
+}
+
+/**
+ * Frees a concurrent hash map and the pairs it stores.
+ * Must not be called while other threads use the map.
+ * @param p_hash_map pointer to dynamically allocated pointer to the map.
+ */
+void ConcurrentHashMapFree(ConcurrentHashMap **p_hash_map){
+    if (!p_hash_map || !(*p_hash_map)){
+        return;
+    }
+    for (size_t i = 0; i < CONCURRENT_HASH_MAP_SEGMENTS; ++i) {
+        pthread_rwlock_destroy(&(*p_hash_map)->segments[i].lock);
+        HashMapFree(&(*p_hash_map)->segments[i].map);
+    }
+    free((*p_hash_map)->segments);
+    free(*p_hash_map);
+    *p_hash_map = NULL;
+}
+
+/**
+ * Inserts a copy of the pair to the concurrent hash map (see HashMapInsert).
+ * @param hash_map the concurrent hash map.
+ * @param pair a pair the map would contain.
+ * @return returns 1 for successful insertion, 0 otherwise.
+ */
+int ConcurrentHashMapInsert(ConcurrentHashMap *hash_map, Pair *pair){
+    if (!hash_map || !pair) return 0;
+    ConcurrentHashMapSegment *segment = GetSegment(hash_map, pair->key);
+    pthread_rwlock_wrlock(&segment->lock);
+    int result = HashMapInsert(segment->map, pair);
+    pthread_rwlock_unlock(&segment->lock);
+    return result;
+}
+
+/**
+ * The function checks if the given key exists in the concurrent hash map.
+ * @param hash_map the concurrent hash map.
+ * @param key the key to be checked.
+ * @return 1 if the key is in the map, 0 otherwise.
+ */
+int ConcurrentHashMapContainsKey(ConcurrentHashMap *hash_map, KeyT key){
+    if (!hash_map || !key) return 0;
+    ConcurrentHashMapSegment *segment = GetSegment(hash_map, key);
+    pthread_rwlock_rdlock(&segment->lock);
+    int result = HashMapContainsKey(segment->map, key);
+    pthread_rwlock_unlock(&segment->lock);
+    return result;
+}
+
+/**
+ * The function checks if the given value exists in the concurrent hash map.
+ * @param hash_map the concurrent hash map.
+ * @param value the value to be checked.
+ * @return 1 if the value is in the map, 0 otherwise.
+ */
+int ConcurrentHashMapContainsValue(ConcurrentHashMap *hash_map, ValueT value){
+    if (!hash_map || !value) return 0;
+    for (size_t i = 0; i < CONCURRENT_HASH_MAP_SEGMENTS; ++i) {
+        ConcurrentHashMapSegment *segment = &hash_map->segments[i];
+        pthread_rwlock_rdlock(&segment->lock);
+        int result = HashMapContainsValue(segment->map, value);
+        pthread_rwlock_unlock(&segment->lock);
+        if (result == 1) return 1;
+    }
+    return 0;
+}
+
+/**
+ * The function returns a *copy* of the value associated with the given key
+ * (the stored value may be freed by another thread at any time).
+ * The copy is made with PairCopyValue of the pair type, and must be freed by
+ * the caller with PairFreeValue.
+ * @param hash_map the concurrent hash map.
+ * @param key the key to be checked.
+ * @return copy of the value associated with key if exists, NULL otherwise.
+ */
+ValueT ConcurrentHashMapAt(ConcurrentHashMap *hash_map, KeyT key){
+    if (!hash_map || !key) return NULL;
+    ConcurrentHashMapSegment *segment = GetSegment(hash_map, key);
+    ValueT copy = NULL;
+    pthread_rwlock_rdlock(&segment->lock);
+    Pair *pair = HashMapGetPair(segment->map, key);
+    if (pair) copy = PairCopyValue(pair->type, pair->value);
+    pthread_rwlock_unlock(&segment->lock);
+    return copy;
+}
+
+/**
+ * The function erases the pair associated with key.
+ * @param hash_map the concurrent hash map.
+ * @param key a key of the pair to be erased.
+ * @return 1 if the erasing was done successfully, 0 otherwise.
+ */
+int ConcurrentHashMapErase(ConcurrentHashMap *hash_map, KeyT key){
+    if (!hash_map || !key) return 0;
+    ConcurrentHashMapSegment *segment = GetSegment(hash_map, key);
+    pthread_rwlock_wrlock(&segment->lock);
+    int result = HashMapErase(segment->map, key);
+    pthread_rwlock_unlock(&segment->lock);
+    return result;
+}
+
+/**
+ * This function returns the number of pairs in the concurrent hash map.
+ * The segments are counted one after the other, so with concurrent writers
+ * the result is a snapshot of each segment, not of the whole map.
+ * @param hash_map the concurrent hash map.
+ * @return the number of pairs in the map.
+ */
+size_t ConcurrentHashMapSize(ConcurrentHashMap *hash_map){
+    if (!hash_map) return 0;
+    size_t size = 0;
+    for (size_t i = 0; i < CONCURRENT_HASH_MAP_SEGMENTS; ++i) {
+        ConcurrentHashMapSegment *segment = &hash_map->segments[i];
+        pthread_rwlock_rdlock(&segment->lock);
+        size += segment->map->size;
+        pthread_rwlock_unlock(&segment->lock);
+    }
+    return size;
+}
+
+/**
+ * This function deletes all the elements in the concurrent hash map.
+ * @param hash_map the concurrent hash map to be cleared.
+ */
+void ConcurrentHashMapClear(ConcurrentHashMap *hash_map){
+    if (!hash_map) return;
+    for (size_t i = 0; i < CONCURRENT_HASH_MAP_SEGMENTS; ++i) {
+        ConcurrentHashMapSegment *segment = &hash_map->segments[i];
+        pthread_rwlock_wrlock(&segment->lock);
+        HashMapClear(segment->map);
+        pthread_rwlock_unlock(&segment->lock);
+    }
+}
+
+/*
+ * This function returns the segment which holds the given key.
+ */
+ConcurrentHashMapSegment *GetSegment(ConcurrentHashMap *hash_map, KeyT key){
+    size_t hash = HashFinalize(hash_map->hash_func(key));
+    return &hash_map->segments[SEGMENT_INDEX(hash)];
+}
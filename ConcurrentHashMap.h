@@ -0,0 +1,122 @@
+#ifndef CONCURRENTHASHMAP_H_
+#define CONCURRENTHASHMAP_H_
+
+#include <stdlib.h>
+#include "HashMap.h"
+
+/**
+ * @def CONCURRENT_HASH_MAP_SEGMENTS
+ * The number of segments (lock stripes) of the concurrent hash map.
+ * Must be a power of 2. (at most 65536).
+ */
+#define CONCURRENT_HASH_MAP_SEGMENTS 64UL
+
+/**
+ * @typedef ConcurrentHashMapSegment
+ * A segment of the concurrent hash map - a HashMap and the read-write lock
+ * which guards it (defined in ConcurrentHashMap.c).
+ */
+typedef struct ConcurrentHashMapSegment ConcurrentHashMapSegment;
+
+/**
+ * @struct ConcurrentHashMap
+ * A thread safe hash map. The keys are split (by hash) between
+ * CONCURRENT_HASH_MAP_SEGMENTS segments, each is a HashMap guarded by its own
+ * read-write lock, so threads working on different segments never wait for
+ * each other, lookups in the same segment run in parallel, and a resize
+ * only blocks its own segment - incrementally, a few buckets per write (see
+ * HashMapSetIncrementalRehash). Every segment has its own cache line.
+ * Pairs are copied and freed (and ConcurrentHashMapAt copies values) while
+ * holding only the lock of their own segment - a read lock for lookups - so
+ * the allocators of the pair types must be thread safe (NULL, i.e. malloc,
+ * is; SlabAllocator is not).
+ * @param segments array of CONCURRENT_HASH_MAP_SEGMENTS segments.
+ * @param hash_func a function which "hashes" keys.
+ */
+typedef struct ConcurrentHashMap {
+  ConcurrentHashMapSegment *segments;
+  HashFunc hash_func;
+} ConcurrentHashMap;
+
+/**
+ * Allocates dynamically new concurrent hash map element.
+ * The pairs stored in it must have a thread safe allocator in their PairType
+ * (NULL for malloc), not a SlabAllocator: segments copy and free pairs in
+ * parallel.
+ * @param hash_func a function which "hashes" keys.
+ * @param pair_cpy a function which copies pairs.
+ * @param pair_cmp a function which compares pairs.
+ * @param pair_free a function which frees pairs.
+ * @return pointer to dynamically allocated ConcurrentHashMap.
+ * @if_fail return NULL.
+ */
+ConcurrentHashMap *ConcurrentHashMapAlloc(
+    HashFunc hash_func, HashMapPairCpy pair_cpy,
+    HashMapPairCmp pair_cmp, HashMapPairFree pair_free);
+
+/**
+ * Frees a concurrent hash map and the pairs it stores.
+ * Must not be called while other threads use the map.
+ * @param p_hash_map pointer to dynamically allocated pointer to the map.
+ */
+void ConcurrentHashMapFree(ConcurrentHashMap **p_hash_map);
+
+/**
+ * Inserts a copy of the pair to the concurrent hash map (see HashMapInsert).
+ * @param hash_map the concurrent hash map.
+ * @param pair a pair the map would contain.
+ * @return returns 1 for successful insertion, 0 otherwise.
+ */
+int ConcurrentHashMapInsert(ConcurrentHashMap *hash_map, Pair *pair);
+
+/**
+ * The function checks if the given key exists in the concurrent hash map.
+ * @param hash_map the concurrent hash map.
+ * @param key the key to be checked.
+ * @return 1 if the key is in the map, 0 otherwise.
+ */
+int ConcurrentHashMapContainsKey(ConcurrentHashMap *hash_map, KeyT key);
+
+/**
+ * The function checks if the given value exists in the concurrent hash map.
+ * @param hash_map the concurrent hash map.
+ * @param value the value to be checked.
+ * @return 1 if the value is in the map, 0 otherwise.
+ */
+int ConcurrentHashMapContainsValue(ConcurrentHashMap *hash_map, ValueT value);
+
+/**
+ * The function returns a *copy* of the value associated with the given key
+ * (the stored value may be freed by another thread at any time).
+ * The copy is made with PairCopyValue of the pair type, and must be freed by
+ * the caller with PairFreeValue.
+ * @param hash_map the concurrent hash map.
+ * @param key the key to be checked.
+ * @return copy of the value associated with key if exists, NULL otherwise.
+ */
+ValueT ConcurrentHashMapAt(ConcurrentHashMap *hash_map, KeyT key);
+
+/**
+ * The function erases the pair associated with key.
+ * @param hash_map the concurrent hash map.
+ * @param key a key of the pair to be erased.
+ * @return 1 if the erasing was done successfully, 0 otherwise.
+ */
+int ConcurrentHashMapErase(ConcurrentHashMap *hash_map, KeyT key);
+
+/**
+ * This function returns the number of pairs in the concurrent hash map.
+ * The segments are counted one after the other, so with concurrent writers
+ * the result is a snapshot of each segment, not of the whole map.
+ * @param hash_map the concurrent hash map.
+ * @return the number of pairs in the map.
+ */
+size_t ConcurrentHashMapSize(ConcurrentHashMap *hash_map);
+
+/**
+ * This function deletes all the elements in the concurrent hash map.
+ * @param hash_map the concurrent hash map to be cleared.
+ */
+void ConcurrentHashMapClear(ConcurrentHashMap *hash_map);
+
+#endif //CONCURRENTHASHMAP_H_
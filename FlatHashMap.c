@@ -0,0 +1,241 @@
+#include <string.h>
+#include "FlatHashMap.h"
+#include "Hash.h"
+
+#define KEY_HASH(func, key) HashFinalize(func(key))
+#define SLOT_INDEX(hash, capacity) ((hash) & ((capacity) - 1))
+#define PROBE_DISTANCE(hash, pos, capacity) \
+    (((pos) - SLOT_INDEX(hash, capacity)) & ((capacity) - 1))
+
+long FindSlot(FlatHashMap *hash_map, KeyT key, size_t hash);
+void PlaceSlot(FlatHashMapSlot *slots, size_t capacity, size_t hash, Pair *pair);
+int ResizeSlots(FlatHashMap *hash_map, size_t new_cap);
+
+/**
+ * Allocates dynamically new flat hash map element.
+ * @param hash_func a function which "hashes" keys.
+ * @param pair_cpy a function which copies pairs.
+ * @param pair_cmp a function which compares pairs.
+ * @param pair_free a function which frees pairs.
+ * @return pointer to dynamically allocated FlatHashMap.
+ * @if_fail return NULL.
+ */
+FlatHashMap *FlatHashMapAlloc(HashFunc hash_func, HashMapPairCpy pair_cpy,
+        HashMapPairCmp pair_cmp, HashMapPairFree pair_free){
+    if (!hash_func || !pair_cpy || !pair_cmp || !pair_free) return NULL;
+    FlatHashMap *new_hash_map = malloc(sizeof(FlatHashMap));
+    if (!new_hash_map) return NULL;
+    new_hash_map->slots = calloc(FLAT_HASH_MAP_INITIAL_CAP, sizeof(FlatHashMapSlot));
+    if (!new_hash_map->slots){
+        free(new_hash_map);
+        return NULL;
+    }
+    new_hash_map->capacity = FLAT_HASH_MAP_INITIAL_CAP;
+    new_hash_map->size = 0;
+    new_hash_map->hash_func = hash_func;
+    new_hash_map->pair_cpy = pair_cpy;
+    new_hash_map->pair_cmp = pair_cmp;
+    new_hash_map->pair_free = pair_free;
+    return new_hash_map;
+}
+
+/**
+ * Frees a flat hash map and the pairs it stores.
+ * @param p_hash_map pointer to dynamically allocated pointer to flat hash map.
+ */
+void FlatHashMapFree(FlatHashMap **p_hash_map){
+    if (!p_hash_map || !(*p_hash_map)){
+        return;
+    }
+    FlatHashMapClear(*p_hash_map);
+    free((*p_hash_map)->slots);
+    (*p_hash_map)->slots = NULL;
+    free(*p_hash_map);
+    *p_hash_map = NULL;
+}
+
+/**
+ * Inserts a new pair to the flat hash map.
+ * The function inserts *new*, *copied*, *dynamically allocated* pair,
+ * NOT the pair it receives as a parameter.
+ * @param hash_map the flat hash map to be inserted with new element.
+ * @param pair a pair the flat hash map would contain.
+ * @return returns 1 for successful insertion, 0 otherwise.
+ */
+int FlatHashMapInsert(FlatHashMap *hash_map, Pair *pair){
+    if (!hash_map || !pair) return 0;
+    size_t hash = KEY_HASH(hash_map->hash_func, pair->key);
+    long pos = FindSlot(hash_map, pair->key, hash);
+    Pair *new_pair = hash_map->pair_cpy(pair);
+    if (!new_pair) return 0;
+    if (pos != -1){
+        hash_map->pair_free((void **) &hash_map->slots[pos].pair);
+        hash_map->slots[pos].pair = new_pair;
+        return 1;
+    }
+    if (hash_map->capacity * FLAT_HASH_MAP_MAX_LOAD_FACTOR < (double) hash_map->size + 1){
+        if (ResizeSlots(hash_map, hash_map->capacity * FLAT_HASH_MAP_GROWTH_FACTOR) == 0){
+            hash_map->pair_free((void **) &new_pair);
+            return 0;
+        }
+    }
+    PlaceSlot(hash_map->slots, hash_map->capacity, hash, new_pair);
+    hash_map->size++;
+    return 1;
+}
+
+/**
+ * The function checks if the given key exists in the flat hash map.
+ * @param hash_map a flat hash map.
+ * @param key the key to be checked.
+ * @return 1 if the key is in the flat hash map, 0 otherwise.
+ */
+int FlatHashMapContainsKey(FlatHashMap *hash_map, KeyT key){
+    if (!hash_map || !key) return 0;
+    return FindSlot(hash_map, key, KEY_HASH(hash_map->hash_func, key)) != -1;
+}
+
+/**
+ * The function checks if the given value exists in the flat hash map.
+ * @param hash_map a flat hash map.
+ * @param value the value to be checked.
+ * @return 1 if the value is in the flat hash map, 0 otherwise.
+ */
+int FlatHashMapContainsValue(FlatHashMap *hash_map, ValueT value){
+    if (!hash_map || !value || hash_map->size == 0) return 0;
+    for (size_t i = 0; i < hash_map->capacity; ++i) {
+        Pair *pair = hash_map->slots[i].pair;
+        if (pair && pair->type->value_cmp(pair->value, value) == 1){
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * The function returns the value associated with the given key.
+ * @param hash_map a flat hash map.
+ * @param key the key to be checked.
+ * @return the value associated with key if exists, NULL otherwise.
+ */
+ValueT FlatHashMapAt(FlatHashMap *hash_map, KeyT key){
+    if (!hash_map || !key) return NULL;
+    long pos = FindSlot(hash_map, key, KEY_HASH(hash_map->hash_func, key));
+    if (pos == -1) return NULL;
+    return hash_map->slots[pos].pair->value;
+}
+
+/**
+ * The function erases the pair associated with key.
+ * The slots array is never shrunk by erasing.
+ * @param hash_map a flat hash map.
+ * @param key a key of the pair to be erased.
+ * @return 1 if the erasing was done successfully, 0 otherwise.
+ */
+int FlatHashMapErase(FlatHashMap *hash_map, KeyT key){
+    if (!hash_map || !key) return 0;
+    long found = FindSlot(hash_map, key, KEY_HASH(hash_map->hash_func, key));
+    if (found == -1) return 0;
+    size_t pos = (size_t) found;
+    size_t mask = hash_map->capacity - 1;
+    hash_map->pair_free((void **) &hash_map->slots[pos].pair);
+    // backward shift deletion - no tombstones are needed.
+    size_t next = (pos + 1) & mask;
+    while (hash_map->slots[next].pair &&
+           PROBE_DISTANCE(hash_map->slots[next].hash, next, hash_map->capacity) != 0){
+        hash_map->slots[pos] = hash_map->slots[next];
+        pos = next;
+        next = (next + 1) & mask;
+    }
+    hash_map->slots[pos].pair = NULL;
+    hash_map->slots[pos].hash = 0;
+    --hash_map->size;
+    return 1;
+}
+
+/**
+ * This function returns the load factor of the flat hash map.
+ * @param hash_map a flat hash map.
+ * @return the flat hash map's load factor, -1 if the function failed.
+ */
+double FlatHashMapGetLoadFactor(FlatHashMap *hash_map){
+    if (!hash_map) return -1;
+    return (double) hash_map->size / (double) hash_map->capacity;
+}
+
+/**
+ * This function deletes all the elements in the flat hash map.
+ * @param hash_map a flat hash map to be cleared.
+ */
+void FlatHashMapClear(FlatHashMap *hash_map){
+    if (!hash_map || hash_map->size == 0) return;
+    for (size_t i = 0; i < hash_map->capacity; ++i) {
+        if (hash_map->slots[i].pair){
+            hash_map->pair_free((void **) &hash_map->slots[i].pair);
+        }
+    }
+    memset(hash_map->slots, 0, hash_map->capacity * sizeof(FlatHashMapSlot));
+    hash_map->size = 0;
+}
+
+/*
+ * This function returns the slot index of the pair with the given key (and its
+ * hash), -1 if not found. The search stops at an empty slot or at a slot which
+ * is closer to its home than the searched key would be (Robin Hood invariant).
+ */
+long FindSlot(FlatHashMap *hash_map, KeyT key, size_t hash){
+    size_t mask = hash_map->capacity - 1;
+    size_t pos = SLOT_INDEX(hash, hash_map->capacity);
+    for (size_t dist = 0; dist < hash_map->capacity; ++dist) {
+        FlatHashMapSlot *slot = &hash_map->slots[pos];
+        if (!slot->pair) return -1;
+        if (PROBE_DISTANCE(slot->hash, pos, hash_map->capacity) < dist) return -1;
+        if (slot->hash == hash && slot->pair->type->key_cmp(slot->pair->key, key) == 1){
+            return (long) pos;
+        }
+        pos = (pos + 1) & mask;
+    }
+    return -1;
+}
+
+/*
+ * This function places a pair (which is known not to be in the slots) into the
+ * slots, displacing pairs which are closer to their home slot (Robin Hood).
+ */
+void PlaceSlot(FlatHashMapSlot *slots, size_t capacity, size_t hash, Pair *pair){
+    size_t mask = capacity - 1;
+    FlatHashMapSlot carried = {hash, pair};
+    size_t pos = SLOT_INDEX(hash, capacity);
+    size_t dist = 0;
+    while (slots[pos].pair){
+        size_t slot_dist = PROBE_DISTANCE(slots[pos].hash, pos, capacity);
+        if (slot_dist < dist){
+            FlatHashMapSlot temp = slots[pos];
+            slots[pos] = carried;
+            carried = temp;
+            dist = slot_dist;
+        }
+        pos = (pos + 1) & mask;
+        ++dist;
+    }
+    slots[pos] = carried;
+}
+
+/*
+ * This function moves all the pairs to a new slots array with the given
+ * capacity, using the cached hashes. Return 1 for success, 0 for failure.
+ */
+int ResizeSlots(FlatHashMap *hash_map, size_t new_cap){
+    FlatHashMapSlot *temp = calloc(new_cap, sizeof(FlatHashMapSlot));
+    if (!temp) return 0;
+    for (size_t i = 0; i < hash_map->capacity; ++i) {
+        FlatHashMapSlot *slot = &hash_map->slots[i];
+        if (slot->pair){
+            PlaceSlot(temp, new_cap, slot->hash, slot->pair);
+        }
+    }
+    free(hash_map->slots);
+    hash_map->slots = temp;
+    hash_map->capacity = new_cap;
+    return 1;
+}
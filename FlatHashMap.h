@@ -0,0 +1,137 @@
+#ifndef FLATHASHMAP_H_
+#define FLATHASHMAP_H_
+
+#include <stdlib.h>
+#include "HashMap.h"
+
+/**
+ * @def FLAT_HASH_MAP_INITIAL_CAP
+ * The initial capacity of the flat hash map.
+ * It means, the initial number of <b> slots </b> the flat hash map has.
+ */
+#define FLAT_HASH_MAP_INITIAL_CAP 16UL
+
+/**
+ * @def FLAT_HASH_MAP_GROWTH_FACTOR
+ * The growth factor of the flat hash map.
+ */
+#define FLAT_HASH_MAP_GROWTH_FACTOR 2UL
+
+/**
+ * @def FLAT_HASH_MAP_MAX_LOAD_FACTOR
+ * The maximal load factor the flat hash map can be in.
+ * Robin Hood probing keeps the probe sequences short, so the slots
+ * array can be filled more than the buckets of HashMap.
+ */
+#define FLAT_HASH_MAP_MAX_LOAD_FACTOR 0.875
+
+/**
+ * @struct FlatHashMapSlot - a single slot of the flat hash map.
+ * @param hash the full hash of the key of the stored pair (cached, so
+ * probing and resizing never call the hash func again).
+ * @param pair the stored pair, NULL if the slot is empty.
+ */
+typedef struct FlatHashMapSlot {
+  size_t hash;
+  Pair *pair;
+} FlatHashMapSlot;
+
+/**
+ * @struct FlatHashMap
+ * An open addressing (Robin Hood, linear probing) hash map.
+ * All the slots are stored in one contiguous array, so a lookup is
+ * usually a single cache line of slots plus the pair itself.
+ * @param slots contiguous array of capacity slots.
+ * @param size the number of elements (pairs) stored in the hash map.
+ * @param capacity the number of slots in the hash map (power of 2).
+ * @param hash_func a function which "hashes" keys.
+ * @param pair_cpy a function which copies pairs.
+ * @param pair_cmp a function which compares pairs.
+ * @param pair_free a function which frees pairs.
+ */
+typedef struct FlatHashMap {
+  FlatHashMapSlot *slots;
+  size_t size;
+  size_t capacity; // num of slots.
+  HashFunc hash_func;
+  HashMapPairCpy pair_cpy;
+  HashMapPairCmp pair_cmp;
+  HashMapPairFree pair_free;
+} FlatHashMap;
+
+/**
+ * Allocates dynamically new flat hash map element.
+ * @param hash_func a function which "hashes" keys.
+ * @param pair_cpy a function which copies pairs.
+ * @param pair_cmp a function which compares pairs.
+ * @param pair_free a function which frees pairs.
+ * @return pointer to dynamically allocated FlatHashMap.
+ * @if_fail return NULL.
+ */
+FlatHashMap *FlatHashMapAlloc(
+    HashFunc hash_func, HashMapPairCpy pair_cpy,
+    HashMapPairCmp pair_cmp, HashMapPairFree pair_free);
+
+/**
+ * Frees a flat hash map and the pairs it stores.
+ * @param p_hash_map pointer to dynamically allocated pointer to flat hash map.
+ */
+void FlatHashMapFree(FlatHashMap **p_hash_map);
+
+/**
+ * Inserts a new pair to the flat hash map.
+ * The function inserts *new*, *copied*, *dynamically allocated* pair,
+ * NOT the pair it receives as a parameter.
+ * @param hash_map the flat hash map to be inserted with new element.
+ * @param pair a pair the flat hash map would contain.
+ * @return returns 1 for successful insertion, 0 otherwise.
+ */
+int FlatHashMapInsert(FlatHashMap *hash_map, Pair *pair);
+
+/**
+ * The function checks if the given key exists in the flat hash map.
+ * @param hash_map a flat hash map.
+ * @param key the key to be checked.
+ * @return 1 if the key is in the flat hash map, 0 otherwise.
+ */
+int FlatHashMapContainsKey(FlatHashMap *hash_map, KeyT key);
+
+/**
+ * The function checks if the given value exists in the flat hash map.
+ * @param hash_map a flat hash map.
+ * @param value the value to be checked.
+ * @return 1 if the value is in the flat hash map, 0 otherwise.
+ */
+int FlatHashMapContainsValue(FlatHashMap *hash_map, ValueT value);
+
+/**
+ * The function returns the value associated with the given key.
+ * @param hash_map a flat hash map.
+ * @param key the key to be checked.
+ * @return the value associated with key if exists, NULL otherwise.
+ */
+ValueT FlatHashMapAt(FlatHashMap *hash_map, KeyT key);
+
+/**
+ * The function erases the pair associated with key.
+ * The slots array is never shrunk by erasing.
+ * @param hash_map a flat hash map.
+ * @param key a key of the pair to be erased.
+ * @return 1 if the erasing was done successfully, 0 otherwise.
+ */
+int FlatHashMapErase(FlatHashMap *hash_map, KeyT key);
+
+/**
+ * This function returns the load factor of the flat hash map.
+ * @param hash_map a flat hash map.
+ * @return the flat hash map's load factor, -1 if the function failed.
+ */
+double FlatHashMapGetLoadFactor(FlatHashMap *hash_map);
+
+/**
+ * This function deletes all the elements in the flat hash map.
+ * @param hash_map a flat hash map to be cleared.
+ */
+void FlatHashMapClear(FlatHashMap *hash_map);
+
+#endif //FLATHASHMAP_H_
@@ -0,0 +1,270 @@
+#include <string.h>
+#include "FlatVector.h"
+#include "SimdFind.h"
+#define ELEM_AT(vector, ind) ((vector)->data + (ind) * (vector)->elem_size)
+
+int FlatShrinkIfNeeded(FlatVector *vector);
+int FoundIndex(FlatVector *vector, size_t ind);
+int FlatResizeData(FlatVector *vector, size_t new_cap);
+
+/**
+ * Allocates dynamically new flat vector element.
+ * @param elem_size the size (in bytes) of every element.
+ * @param elem_cmp_func func which is used to compare elements stored in the
+ * vector (NULL compares their bytes).
+ * @return pointer to dynamically allocated flat vector.
+ * @if_fail return NULL.
+ */
+FlatVector *FlatVectorAlloc(size_t elem_size, FlatVectorElemCmp elem_cmp_func){
+    return FlatVectorAllocWith(elem_size, elem_cmp_func, NULL);
+}
+
+/**
+ * Allocates dynamically new flat vector element, using the given allocator
+ * for the vector and its data.
+ * @param elem_size the size (in bytes) of every element.
+ * @param elem_cmp_func func which is used to compare elements stored in the
+ * vector (NULL compares their bytes).
+ * @param allocator the allocator to use (NULL for malloc).
+ * @return pointer to dynamically allocated flat vector.
+ * @if_fail return NULL.
+ */
+FlatVector *FlatVectorAllocWith(size_t elem_size, FlatVectorElemCmp elem_cmp_func,
+                                const Allocator *allocator){
+    if (elem_size == 0) return NULL;
+    FlatVector *new_vector = AllocatorAlloc(allocator, sizeof(FlatVector));
+    if (!new_vector) return NULL;
+    new_vector->data = AllocatorAlloc(allocator, VECTOR_INITIAL_CAP * elem_size);
+    if (!new_vector->data){
+        AllocatorFree(allocator, new_vector, sizeof(FlatVector));
+        return NULL;
+    }
+    new_vector->capacity = VECTOR_INITIAL_CAP;
+    new_vector->size = 0;
+    new_vector->elem_size = elem_size;
+    new_vector->elem_cmp_func = elem_cmp_func;
+    new_vector->allocator = allocator;
+    new_vector->growth_factor = VECTOR_GROWTH_FACTOR;
+    return new_vector;
+}
+
+/**
+ * Frees a flat vector and its elements.
+ * @param p_vector pointer to dynamically allocated pointer to flat vector.
+ */
+void FlatVectorFree(FlatVector **p_vector){
+    if (!p_vector || !(*p_vector)){
+        return;
+    }
+    const Allocator *allocator = (*p_vector)->allocator;
+    AllocatorFree(allocator, (*p_vector)->data,
+                  (*p_vector)->capacity * (*p_vector)->elem_size);
+    AllocatorFree(allocator, *p_vector, sizeof(FlatVector));
+    *p_vector = NULL;
+}
+
+/**
+ * Returns the element at the given index.
+ * @param vector pointer to a flat vector.
+ * @param ind the index of the element we want to get.
+ * @return pointer to the element at the given index (inside the vector, valid
+ * until the vector changes), NULL if there is no such index.
+ */
+void *FlatVectorAt(FlatVector *vector, size_t ind){
+    if (!vector || ind >= vector->size) return NULL;
+    return ELEM_AT(vector, ind);
+}
+
+/**
+ * Gets a value and checks if the value is in the flat vector.
+ * @param vector a pointer to flat vector.
+ * @param value pointer to the value to look for (elem_size bytes).
+ * @return the index of the given value if it is in the
+ * vector ([0, vector_size - 1]).
+ * Returns -1 if no such value in the vector.
+ */
+int FlatVectorFind(FlatVector *vector, const void *value){
+    if (!vector || !value) return -1;
+    const char *elem = vector->data;
+    if (!vector->elem_cmp_func){
+        uint32_t value32;
+        uint64_t value64;
+        switch (vector->elem_size) {
+            case 1:
+                return FoundIndex(vector, SimdFindU8(elem, vector->size,
+                                                     *(const uint8_t *) value));
+            case 4:
+                memcpy(&value32, value, sizeof(value32));
+                return FoundIndex(vector, SimdFindU32(elem, vector->size, value32));
+            case 8:
+                memcpy(&value64, value, sizeof(value64));
+                return FoundIndex(vector, SimdFindU64(elem, vector->size, value64));
+            default:
+                break;
+        }
+        for (size_t i = 0; i < vector->size; ++i, elem += vector->elem_size) {
+            if (memcmp(elem, value, vector->elem_size) == 0) return i;
+        }
+        return -1;
+    }
+    for (size_t i = 0; i < vector->size; ++i, elem += vector->elem_size) {
+        if (vector->elem_cmp_func(elem, value) == 1) return i;
+    }
+    return -1;
+}
+
+/**
+ * FlatVectorFind for flat vectors of chars, ints and doubles.
+ * These (and FlatVectorFind of 1, 4 and 8 bytes elements without
+ * elem_cmp_func) use the SIMD kernels of SimdFind.h. Doubles are compared
+ * with == (0.0 equals -0.0, NaN is never found).
+ * @param vector a pointer to flat vector whose elem_size is the size of the
+ * type.
+ * @param value the value to look for.
+ * @return the index of the given value, -1 if no such value in the vector
+ * (or the vector holds another type).
+ */
+int FlatVectorFindChar(FlatVector *vector, char value){
+    if (!vector || vector->elem_size != sizeof(char)) return -1;
+    return FoundIndex(vector, SimdFindU8(vector->data, vector->size, (uint8_t) value));
+}
+
+int FlatVectorFindInt(FlatVector *vector, int value){
+    if (!vector || vector->elem_size != sizeof(int)) return -1;
+    return FoundIndex(vector, SimdFindU32(vector->data, vector->size, (uint32_t) value));
+}
+
+int FlatVectorFindDouble(FlatVector *vector, double value){
+    if (!vector || vector->elem_size != sizeof(double)) return -1;
+    return FoundIndex(vector, SimdFindDouble((const double *) vector->data,
+                                             vector->size, value));
+}
+
+/**
+ * Copies a new value to the back (index vector_size) of the flat vector.
+ * @param vector a pointer to flat vector.
+ * @param value pointer to the value to be added (elem_size bytes).
+ * @return 1 if the adding has been done successfully, 0 otherwise.
+ */
+int FlatVectorPushBack(FlatVector *vector, const void *value){
+    if (!vector || !value) return 0;
+    if (vector->capacity * VECTOR_MAX_LOAD_FACTOR < (double) vector->size + 1){
+        size_t new_cap = (size_t) ((double) vector->capacity * vector->growth_factor);
+        if (new_cap <= vector->capacity) new_cap = vector->capacity + 1;
+        if (FlatResizeData(vector, new_cap) == 0) return 0;
+    }
+    memcpy(ELEM_AT(vector, vector->size), value, vector->elem_size);
+    vector->size++;
+    return 1;
+}
+
+/**
+ * Removes the element at the given index from the flat vector.
+ * @param vector a pointer to flat vector.
+ * @param ind the index of the element to be removed.
+ * @return 1 if the removing has been done successfully, 0 otherwise.
+ */
+int FlatVectorErase(FlatVector *vector, size_t ind){
+    if (!vector || ind >= vector->size) return 0;
+    memmove(ELEM_AT(vector, ind), ELEM_AT(vector, ind + 1),
+            (vector->size - ind - 1) * vector->elem_size);
+    vector->size--;
+    return FlatShrinkIfNeeded(vector);
+}
+
+/**
+ * Deletes all the elements in the flat vector.
+ * @param vector a pointer to flat vector.
+ */
+void FlatVectorClear(FlatVector *vector){
+    if (!vector || vector->size == 0) return;
+    vector->size = 0;
+    FlatShrinkIfNeeded(vector);
+}
+
+/**
+ * This function returns the load factor of the flat vector.
+ * @param vector a flat vector.
+ * @return the vector's load factor, -1 if the function failed.
+ */
+double FlatVectorGetLoadFactor(FlatVector *vector){
+    if (!vector) return -1;
+    if (vector->capacity == 0) return -1;
+    return (double) vector->size / (double) vector->capacity;
+}
+
+/**
+ * Makes room for at least n elements in the flat vector, so pushing up to n
+ * elements does not reallocate its data.
+ * @param vector a pointer to flat vector.
+ * @param n the number of elements the vector should hold.
+ * @return 1 for success, 0 otherwise.
+ */
+int FlatVectorReserve(FlatVector *vector, size_t n){
+    if (!vector) return 0;
+    if (n <= vector->capacity) return 1;
+    return FlatResizeData(vector, n);
+}
+
+/**
+ * Decreases the capacity of the flat vector to its size (at least 1).
+ * @param vector a pointer to flat vector.
+ * @return 1 for success, 0 otherwise.
+ */
+int FlatVectorShrinkToFit(FlatVector *vector){
+    if (!vector) return 0;
+    size_t new_cap = vector->size > 0 ? vector->size : 1;
+    if (new_cap >= vector->capacity) return 1;
+    return FlatResizeData(vector, new_cap);
+}
+
+/**
+ * Sets the factor the capacity is multiplied by when the flat vector is full
+ * (VECTOR_GROWTH_FACTOR by default).
+ * @param vector a pointer to flat vector.
+ * @param growth_factor the growth factor, bigger than 1.
+ * @return 1 for success, 0 otherwise.
+ */
+int FlatVectorSetGrowthFactor(FlatVector *vector, double growth_factor){
+    if (!vector || !(growth_factor > 1)) return 0;
+    vector->growth_factor = growth_factor;
+    return 1;
+}
+
+/*
+ * This function decreases the capacity of the flat vector like Vector does
+ * (see ShrinkIfNeeded in Vector.c). Returns 1 for success, 0 for failure.
+ */
+int FlatShrinkIfNeeded(FlatVector *vector){
+    if (FlatVectorGetLoadFactor(vector) < VECTOR_MIN_LOAD_FACTOR){
+        size_t new_cap = (size_t) ((double) vector->size /
+                                   VECTOR_SHRINK_TARGET_LOAD_FACTOR);
+        if (new_cap < VECTOR_INITIAL_CAP) new_cap = VECTOR_INITIAL_CAP;
+        if (new_cap >= vector->capacity) return 1;
+        return FlatResizeData(vector, new_cap);
+    }
+    return 1;
+}
+
+/*
+ * This function converts the result of a SimdFind kernel (size if not found)
+ * to the index FlatVectorFind returns.
+ */
+int FoundIndex(FlatVector *vector, size_t ind){
+    return ind < vector->size ? (int) ind : -1;
+}
+
+/*
+ * This function reallocates the data of the flat vector to new_cap elements
+ * (new_cap >= size, > 0). Returns 1 for success, 0 for failure (the data is
+ * unchanged).
+ */
+int FlatResizeData(FlatVector *vector, size_t new_cap){
+    char *temp = AllocatorResize(vector->allocator, vector->data,
+                                 vector->capacity * vector->elem_size,
+                                 new_cap * vector->elem_size);
+    if (!temp) return 0;
+    vector->capacity = new_cap;
+    vector->data = temp;
+    return 1;
+}
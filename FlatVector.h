@@ -0,0 +1,159 @@
+#ifndef FLATVECTOR_H_
+#define FLATVECTOR_H_
+
+#include <stdlib.h>
+#include "Vector.h"
+
+/**
+ * @typedef FlatVectorElemCmp
+ * Function which receives pointers to two elements stored in the flat vector
+ * and returns 1 if they are equal, 0 otherwise.
+ */
+typedef int (*FlatVectorElemCmp)(const void *, const void *);
+
+/**
+ * @struct FlatVector - a vector which stores its elements by value.
+ * All the elements have the same size and are stored one after the other in
+ * one array, so a vector of ints is a dense int array (no copy per element).
+ * The elements are copied with memcpy, so they must be trivially copyable
+ * (no pointers the vector should own). Uses the capacity policy of Vector
+ * (VECTOR_INITIAL_CAP, VECTOR_MAX_LOAD_FACTOR etc.).
+ * @param capacity - the capacity of the vector (in elements).
+ * @param size - the current size of the vector.
+ * @param elem_size - the size (in bytes) of every element.
+ * @param data - the elements stored inside the vector.
+ * @param elem_cmp_func - a function which compares the elements stored in
+ * the vector (NULL compares their bytes).
+ * @param allocator - the allocator of the vector itself and its data
+ * (NULL for malloc).
+ * @param growth_factor - the factor the capacity is multiplied by when the
+ * vector is full.
+ */
+typedef struct FlatVector {
+  size_t capacity;
+  size_t size;
+  size_t elem_size;
+  char *data;
+  FlatVectorElemCmp elem_cmp_func;
+  const Allocator *allocator;
+  double growth_factor;
+} FlatVector;
+
+/**
+ * Allocates dynamically new flat vector element.
+ * @param elem_size the size (in bytes) of every element.
+ * @param elem_cmp_func func which is used to compare elements stored in the
+ * vector (NULL compares their bytes).
+ * @return pointer to dynamically allocated flat vector.
+ * @if_fail return NULL.
+ */
+FlatVector *FlatVectorAlloc(size_t elem_size, FlatVectorElemCmp elem_cmp_func);
+
+/**
+ * Allocates dynamically new flat vector element, using the given allocator
+ * for the vector and its data.
+ * @param elem_size the size (in bytes) of every element.
+ * @param elem_cmp_func func which is used to compare elements stored in the
+ * vector (NULL compares their bytes).
+ * @param allocator the allocator to use (NULL for malloc).
+ * @return pointer to dynamically allocated flat vector.
+ * @if_fail return NULL.
+ */
+FlatVector *FlatVectorAllocWith(size_t elem_size, FlatVectorElemCmp elem_cmp_func,
+                                const Allocator *allocator);
+
+/**
+ * Frees a flat vector and its elements.
+ * @param p_vector pointer to dynamically allocated pointer to flat vector.
+ */
+void FlatVectorFree(FlatVector **p_vector);
+
+/**
+ * Returns the element at the given index.
+ * @param vector pointer to a flat vector.
+ * @param ind the index of the element we want to get.
+ * @return pointer to the element at the given index (inside the vector, valid
+ * until the vector changes), NULL if there is no such index.
+ */
+void *FlatVectorAt(FlatVector *vector, size_t ind);
+
+/**
+ * Gets a value and checks if the value is in the flat vector.
+ * @param vector a pointer to flat vector.
+ * @param value pointer to the value to look for (elem_size bytes).
+ * @return the index of the given value if it is in the
+ * vector ([0, vector_size - 1]).
+ * Returns -1 if no such value in the vector.
+ */
+int FlatVectorFind(FlatVector *vector, const void *value);
+
+/**
+ * FlatVectorFind for flat vectors of chars, ints and doubles.
+ * These (and FlatVectorFind of 1, 4 and 8 bytes elements without
+ * elem_cmp_func) use the SIMD kernels of SimdFind.h. Doubles are compared
+ * with == (0.0 equals -0.0, NaN is never found).
+ * @param vector a pointer to flat vector whose elem_size is the size of the
+ * type.
+ * @param value the value to look for.
+ * @return the index of the given value, -1 if no such value in the vector
+ * (or the vector holds another type).
+ */
+int FlatVectorFindChar(FlatVector *vector, char value);
+int FlatVectorFindInt(FlatVector *vector, int value);
+int FlatVectorFindDouble(FlatVector *vector, double value);
+
+/**
+ * Copies a new value to the back (index vector_size) of the flat vector.
+ * @param vector a pointer to flat vector.
+ * @param value pointer to the value to be added (elem_size bytes).
+ * @return 1 if the adding has been done successfully, 0 otherwise.
+ */
+int FlatVectorPushBack(FlatVector *vector, const void *value);
+
+/**
+ * Removes the element at the given index from the flat vector.
+ * @param vector a pointer to flat vector.
+ * @param ind the index of the element to be removed.
+ * @return 1 if the removing has been done successfully, 0 otherwise.
+ */
+int FlatVectorErase(FlatVector *vector, size_t ind);
+
+/**
+ * Deletes all the elements in the flat vector.
+ * @param vector a pointer to flat vector.
+ */
+void FlatVectorClear(FlatVector *vector);
+
+/**
+ * This function returns the load factor of the flat vector.
+ * @param vector a flat vector.
+ * @return the vector's load factor, -1 if the function failed.
+ */
+double FlatVectorGetLoadFactor(FlatVector *vector);
+
+/**
+ * Makes room for at least n elements in the flat vector, so pushing up to n
+ * elements does not reallocate its data.
+ * @param vector a pointer to flat vector.
+ * @param n the number of elements the vector should hold.
+ * @return 1 for success, 0 otherwise.
+ */
+int FlatVectorReserve(FlatVector *vector, size_t n);
+
+/**
+ * Decreases the capacity of the flat vector to its size (at least 1).
+ * @param vector a pointer to flat vector.
+ * @return 1 for success, 0 otherwise.
+ */
+int FlatVectorShrinkToFit(FlatVector *vector);
+
+/**
+ * Sets the factor the capacity is multiplied by when the flat vector is full
+ * (VECTOR_GROWTH_FACTOR by default).
+ * @param vector a pointer to flat vector.
+ * @param growth_factor the growth factor, bigger than 1.
+ * @return 1 for success, 0 otherwise.
+ */
+int FlatVectorSetGrowthFactor(FlatVector *vector, double growth_factor);
+
+#endif //FLATVECTOR_H_
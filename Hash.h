@@ -2,29 +2,98 @@
 #define HASH_H_
 
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 
 /**
- * Integers simple hash func.
+ * @def HASH_SEED
+ * The default seed of the byte and string hash funcs.
  */
-size_t HashInt(void *elem){
-  size_t hash = (*((int *) elem));
-  return hash;
+#define HASH_SEED 0x9E3779B97F4A7C15ULL
+
+/**
+ * Mixes the bits of a 64 bit number (splitmix64 finalizer), so every input bit
+ * affects every output bit (avalanche). Sequential and stride-aligned inputs
+ * are spread over all the low bits, which are the ones used for masking.
+ */
+static inline uint64_t HashMix64(uint64_t x){
+  x ^= x >> 30;
+  x *= 0xBF58476D1CE4E5B9ULL;
+  x ^= x >> 27;
+  x *= 0x94D049BB133111EBULL;
+  x ^= x >> 31;
+  return x;
+}
+
+/**
+ * Finalizer which is applied to the result of every hash func before it is
+ * masked to a bucket, so even weak (e.g. identity) hash funcs spread well.
+ */
+static inline size_t HashFinalize(size_t hash){
+  return (size_t) HashMix64((uint64_t) hash);
+}
+
+/**
+ * Hashes len bytes starting at data with the given seed.
+ * The bytes are read 8 at a time, every word is mixed into the state and the
+ * state is finalized with HashMix64.
+ */
+static inline size_t HashBytes(const void *data, size_t len, uint64_t seed){
+  const unsigned char *bytes = (const unsigned char *) data;
+  uint64_t hash = seed ^ ((uint64_t) len * 0x9E3779B97F4A7C15ULL);
+  while (len >= 8) {
+    uint64_t word;
+    memcpy(&word, bytes, 8);
+    hash ^= HashMix64(word);
+    hash = ((hash << 27) | (hash >> 37)) * 0x9E3779B97F4A7C15ULL + 0x94D049BB133111EBULL;
+    bytes += 8;
+    len -= 8;
+  }
+  if (len > 0) {
+    uint64_t word = 0;
+    memcpy(&word, bytes, len);
+    hash ^= HashMix64(word ^ len);
+  }
+  return (size_t) HashMix64(hash);
+}
+
+/**
+ * Integers hash func.
+ */
+static inline size_t HashInt(void *elem){
+  return (size_t) HashMix64((uint64_t) (unsigned int) (*((int *) elem)));
+}
+
+/**
+ * Chars hash func.
+ */
+static inline size_t HashChar(void *elem){
+  return (size_t) HashMix64((uint64_t) (unsigned char) (*((char *) elem)));
 }
 
 /**
- * Chars simple hash func.
+ * Doubles hash func.
+ * Hashes the bit pattern (so 1.1 and 1.9 do not collide), with +0 and -0
+ * hashed the same (they are equal), and all the NaNs hashed the same.
  */
-size_t HashChar(void *elem){
-  size_t hash = (*((char *) elem));
-  return hash;
+static inline size_t HashDouble(void *elem){
+  double value = *((double *) elem);
+  uint64_t bits;
+  if (value == 0.0) {
+    value = 0.0;
+  } else if (value != value) {
+    return (size_t) HashMix64(0x7FF8000000000000ULL);
+  }
+  memcpy(&bits, &value, sizeof(bits));
+  return (size_t) HashMix64(bits);
 }
 
 /**
- * Doubles simple hash func.
+ * Strings (null terminated char *) hash func.
  */
-size_t HashDouble(void *elem){
-  size_t hash = (*((double *) elem));
-  return hash;
+static inline size_t HashString(void *elem){
+  const char *str = (const char *) elem;
+  return HashBytes(str, strlen(str), HASH_SEED);
 }
 
 #endif // HASH_H_
@@ -2,16 +2,71 @@
 // Created by Raz on 03/12/2020.
 //
 
+#define _POSIX_C_SOURCE 200809L
+#include <string.h>
 #include "HashMap.h"
-#define HASH(func, key, capacity) func(key) & (capacity-1)
+#include "Hash.h"
+#define KEY_HASH(func, key) HashFinalize(func(key))
+#define BUCKET_INDEX(hash, capacity) ((hash) & ((capacity)-1))
 
-Vector **InitBuckets(size_t size, VectorElemCpy cpy_func, VectorElemCmp cmp_func,
-                      VectorElemFree free_func);
+#if defined(__GNUC__)
+#define PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define PREFETCH(addr) ((void) (addr))
+#endif
+
+#ifdef HASH_MAP_STATS
+#include <time.h>
+#define STATS_ADD(map, field, n) ((map)->stats.field += (n))
+#define STATS_RESIZE(map, new_cap) \
+    ((new_cap) > (map)->capacity ? (map)->stats.grows++ : (map)->stats.shrinks++)
+#define STATS_START(start) double start = StatsNow()
+#define STATS_TIME(map, start) ((map)->stats.rehash_time += StatsNow() - (start))
+#define STATS_PROBES(map, bucket, pair_index, lookups) \
+    CountProbes(map, bucket, pair_index, lookups)
+#else
+#define STATS_ADD(map, field, n) ((void) 0)
+#define STATS_RESIZE(map, new_cap) ((void) 0)
+#define STATS_START(start) ((void) 0)
+#define STATS_TIME(map, start) ((void) 0)
+#define STATS_PROBES(map, bucket, pair_index, lookups) ((void) 0)
+#endif
+
+/*
+ * State of HashMapCountValue's scan (without a value index).
+ */
+typedef struct ValueCount {
+  ValueT value;
+  size_t count;
+} ValueCount;
+
+Vector **InitBuckets(const Allocator *allocator, size_t size);
+Vector *GetBucket(HashMap *hash_map, Vector **buckets, size_t ind);
 void FreeBuckets(Vector** buckets, size_t size);
+void ReleaseBuckets(Vector** buckets, size_t size);
 Vector** ReHashing(HashMap *hash_map, size_t new_cap);
-int IncreaseTable(HashMap *hash_map, size_t new_cap, Pair* pair);
-int DecreaseTable(HashMap *hash_map, size_t new_cap);
-int GetPairIndexByKey(Vector * vec, KeyT key);
+int IncreaseTable(HashMap *hash_map, size_t new_cap, Pair* new_pair);
+int InsertHashed(HashMap *hash_map, Pair *pair, size_t hash);
+int InsertOwnedHashed(HashMap *hash_map, Pair *new_pair, size_t hash);
+int InsertNewHashed(HashMap *hash_map, Pair *new_pair, size_t hash);
+int AfterErase(HashMap *hash_map);
+int DecreaseTable(HashMap *hash_map);
+int ResizeTable(HashMap *hash_map, size_t new_cap);
+size_t CapacityFor(size_t size, double load_factor);
+int GetPairIndexByKey(Vector * vec, KeyT key, size_t hash);
+Pair *CopyPair(HashMap *hash_map, Pair *pair, size_t hash);
+Vector *LocatePair(HashMap *hash_map, KeyT key, size_t hash, int *pair_index);
+int StartRehash(HashMap *hash_map, size_t new_cap);
+int RehashStep(HashMap *hash_map, size_t steps);
+int FinishRehash(HashMap *hash_map);
+Vector **BucketsOf(HashMap *hash_map, size_t bucket, size_t *count);
+void IndexPair(HashMap *hash_map, Pair *pair);
+void UnindexPair(HashMap *hash_map, Pair *pair);
+int CountPairValue(Pair *pair, void *ctx);
+#ifdef HASH_MAP_STATS
+void CountProbes(HashMap *hash_map, Vector *bucket, int pair_index, size_t lookups);
+double StatsNow(void);
+#endif
 
 /**
  * Allocates dynamically new hash map element.
@@ -24,13 +79,31 @@ int GetPairIndexByKey(Vector * vec, KeyT key);
  */
 HashMap *HashMapAlloc(HashFunc hash_func, HashMapPairCpy pair_cpy,
         HashMapPairCmp pair_cmp, HashMapPairFree pair_free){
+    return HashMapAllocWith(hash_func, pair_cpy, pair_cmp, pair_free, NULL);
+}
+
+/**
+ * Allocates dynamically new hash map element, using the given allocator for
+ * the hash map, its buckets and their vectors (the pairs are still copied by
+ * pair_cpy, set the allocator - and key_size / value_size - of their PairType
+ * to pool them too).
+ * @param hash_func a function which "hashes" keys.
+ * @param pair_cpy a function which copies pairs.
+ * @param pair_cmp a function which compares pairs.
+ * @param pair_free a function which frees pairs.
+ * @param allocator the allocator to use (NULL for malloc).
+ * @return pointer to dynamically allocated HashMap.
+ * @if_fail return NULL.
+ */
+HashMap *HashMapAllocWith(HashFunc hash_func, HashMapPairCpy pair_cpy,
+        HashMapPairCmp pair_cmp, HashMapPairFree pair_free,
+        const Allocator *allocator){
     if (!hash_func || !pair_cpy || !pair_cmp || !pair_free) return NULL;
-    HashMap * new_hash_map = malloc(sizeof(HashMap));
+    HashMap * new_hash_map = AllocatorAlloc(allocator, sizeof(HashMap));
     if (!new_hash_map) return NULL;
-    new_hash_map->buckets = InitBuckets(HASH_MAP_INITIAL_CAP, pair_cpy, pair_cmp,
-                                        pair_free);
+    new_hash_map->buckets = InitBuckets(allocator, HASH_MAP_INITIAL_CAP);
     if (!new_hash_map->buckets){
-        free(new_hash_map);
+        AllocatorFree(allocator, new_hash_map, sizeof(HashMap));
         return NULL;
     }
     new_hash_map->capacity = HASH_MAP_INITIAL_CAP;
@@ -39,6 +112,16 @@ HashMap *HashMapAlloc(HashFunc hash_func, HashMapPairCpy pair_cpy,
     new_hash_map->pair_cpy = pair_cpy;
     new_hash_map->pair_cmp = pair_cmp;
     new_hash_map->pair_free = pair_free;
+    new_hash_map->shrink_policy = HASH_MAP_SHRINK_EAGER;
+    new_hash_map->allocator = allocator;
+    new_hash_map->old_buckets = NULL;
+    new_hash_map->old_capacity = 0;
+    new_hash_map->rehash_index = 0;
+    new_hash_map->incremental_rehash = 0;
+    new_hash_map->value_index = NULL;
+#ifdef HASH_MAP_STATS
+    memset(&new_hash_map->stats, 0, sizeof(HashMapStats));
+#endif
     return new_hash_map;
 }
 
@@ -52,25 +135,175 @@ HashMap *HashMapAlloc(HashFunc hash_func, HashMapPairCpy pair_cpy,
  */
 int HashMapInsert(HashMap *hash_map, Pair *pair){
     if (!hash_map || !pair) return 0;
-    size_t vector_index = HASH(hash_map->hash_func, pair->key, hash_map->capacity);
-    int pair_index = GetPairIndexByKey(hash_map->buckets[vector_index], pair->key);
-    if (pair_index != -1){
-        hash_map->pair_free(&hash_map->buckets[vector_index]->data[pair_index]);
-        hash_map->buckets[vector_index]->data[pair_index] = hash_map->pair_cpy(pair);
+    return InsertHashed(hash_map, pair, KEY_HASH(hash_map->hash_func, pair->key));
+}
+
+/**
+ * This function makes room for at least n pairs in the hash map, so inserting
+ * up to n pairs does not increase (rehash) the buckets again.
+ * @param hash_map a hash map.
+ * @param n the number of pairs the hash map should hold.
+ * @return 1 for success, 0 otherwise.
+ */
+int HashMapReserve(HashMap *hash_map, size_t n){
+    if (!hash_map) return 0;
+    size_t new_cap = CapacityFor(n, HASH_MAP_MAX_LOAD_FACTOR);
+    if (new_cap == 0) return 0;
+    if (new_cap <= hash_map->capacity) return 1;
+    if (FinishRehash(hash_map) == 0) return 0;
+    return ResizeTable(hash_map, new_cap);
+}
+
+/**
+ * Inserts n pairs to the hash map (copies of them, like HashMapInsert).
+ * The buckets are sized once for all the pairs and all the keys are hashed
+ * before inserting, so there are no intermediate rehashes.
+ * @param hash_map the hash map to be inserted with new elements.
+ * @param pairs array of n pairs the hash map would contain.
+ * @param n the number of pairs.
+ * @return returns 1 if all the pairs were inserted, 0 otherwise.
+ */
+int HashMapInsertBulk(HashMap *hash_map, Pair **pairs, size_t n){
+    if (!hash_map || (!pairs && n > 0)) return 0;
+    if (n > SIZE_MAX - hash_map->size || n > SIZE_MAX / sizeof(size_t)) return 0;
+    if (HashMapReserve(hash_map, hash_map->size + n) == 0) return 0;
+    size_t *hashes = malloc(n * sizeof(size_t));
+    if (!hashes && n > 0) return 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (!pairs[i]){
+            free(hashes);
+            return 0;
+        }
+        hashes[i] = KEY_HASH(hash_map->hash_func, pairs[i]->key);
+    }
+    for (size_t i = 0; i < n; ++i) {
+        if (InsertHashed(hash_map, pairs[i], hashes[i]) == 0){
+            free(hashes);
+            return 0;
+        }
+    }
+    free(hashes);
+    return 1;
+}
+
+/**
+ * Inserts the given pair itself (NOT a copy of it) to the hash map, which
+ * takes ownership of it: it would be freed with pair_free, so the pair must
+ * be allocated the way pair_free expects (e.g. PairAlloc for PairFree).
+ * An existing pair with the same key is freed and replaced.
+ * @param hash_map the hash map to be inserted with new element.
+ * @param pair dynamically allocated pair to be moved into the hash map.
+ * @return returns 1 for successful insertion, 0 otherwise (the pair is then
+ * still owned by the caller).
+ */
+int HashMapInsertOwned(HashMap *hash_map, Pair *pair){
+    if (!hash_map || !pair) return 0;
+    return InsertOwnedHashed(hash_map, pair, KEY_HASH(hash_map->hash_func, pair->key));
+}
+
+/**
+ * Constructs a new pair of the given type (copying the key and the value
+ * once) directly in the hash map, instead of building a pair and inserting
+ * a copy of it. The pairs of the hash map must be freeable by PairFree.
+ * @param hash_map the hash map to be inserted with new element.
+ * @param key, value the key and value of the new pair.
+ * @param type the type of the new pair.
+ * @return returns 1 for successful insertion, 0 otherwise.
+ */
+int HashMapEmplace(HashMap *hash_map, KeyT key, ValueT value, const PairType *type){
+    if (!hash_map || !key || !value || !type) return 0;
+    Pair *new_pair = PairAlloc(key, value, type);
+    if (!new_pair) return 0;
+    if (HashMapInsertOwned(hash_map, new_pair) == 0){
+        hash_map->pair_free((void **) &new_pair);
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * Replaces the value associated with key by a copy of the given value,
+ * keeping the pair and its key as they are.
+ * @param hash_map a hash map.
+ * @param key the key whose value is replaced.
+ * @param value the new value.
+ * @return 1 if the value was replaced, 0 otherwise (e.g. no such key).
+ */
+int HashMapUpdateValue(HashMap *hash_map, KeyT key, ValueT value){
+    if (!value) return 0;
+    Pair *pair = HashMapGetPair(hash_map, key);
+    if (!pair) return 0;
+    ValueT new_value = PairCopyValue(pair->type, value);
+    if (!new_value) return 0;
+    UnindexPair(hash_map, pair);
+    PairFreeValue(pair->type, &pair->value);
+    pair->value = new_value;
+    IndexPair(hash_map, pair);
+    return 1;
+}
+
+/*
+ * This function inserts a copy of the pair, whose key hash is already known,
+ * to the hashmap. Return 1 for success, 0 for failure
+ */
+int InsertHashed(HashMap *hash_map, Pair *pair, size_t hash){
+    Pair *new_pair = CopyPair(hash_map, pair, hash);
+    if (!new_pair) return 0;
+    if (InsertOwnedHashed(hash_map, new_pair, hash) == 0){
+        hash_map->pair_free((void **) &new_pair);
+        return 0;
+    }
+    return 1;
+}
+
+/*
+ * This function inserts the pair itself, whose key hash is already known, to
+ * the hashmap. Return 1 for success, 0 for failure (the pair is not freed)
+ */
+int InsertOwnedHashed(HashMap *hash_map, Pair *new_pair, size_t hash){
+    new_pair->hash = hash;
+    int pair_index;
+    Vector *bucket = LocatePair(hash_map, new_pair->key, hash, &pair_index);
+    if (bucket){
+        UnindexPair(hash_map, (Pair *) bucket->data[pair_index]);
+        hash_map->pair_free(&bucket->data[pair_index]);
+        STATS_ADD(hash_map, pair_frees, 1);
+        bucket->data[pair_index] = new_pair;
+        IndexPair(hash_map, new_pair);
         return 1;
     }
-    if (hash_map->capacity * HASH_MAP_MAX_LOAD_FACTOR < (double) hash_map->size + 1){
-        if (IncreaseTable(hash_map, hash_map->capacity * HASH_MAP_GROWTH_FACTOR, pair) == 0){
+    return InsertNewHashed(hash_map, new_pair, hash);
+}
+
+/*
+ * This function inserts the pair itself, whose key is known not to be in the
+ * hashmap, growing the buckets if needed. Return 1 for success, 0 for failure
+ * (the pair is not freed)
+ */
+int InsertNewHashed(HashMap *hash_map, Pair *new_pair, size_t hash){
+    new_pair->hash = hash;
+    int grow = hash_map->capacity * HASH_MAP_MAX_LOAD_FACTOR < (double) hash_map->size + 1;
+    if (grow && !hash_map->incremental_rehash){
+        if (IncreaseTable(hash_map, hash_map->capacity * HASH_MAP_GROWTH_FACTOR,
+                          new_pair) == 0){
             return 0;
         }
     }
     else {
-        size_t ind = HASH(hash_map->hash_func, pair->key, hash_map->capacity);
-        if (VectorPushBack(hash_map->buckets[ind], pair) == 0){
+        // while migrating, the new buckets take the new pairs (and grow later).
+        if (grow && !hash_map->old_buckets &&
+            StartRehash(hash_map, hash_map->capacity * HASH_MAP_GROWTH_FACTOR) == 0){
+            return 0;
+        }
+        size_t vector_index = BUCKET_INDEX(hash, hash_map->capacity);
+        if (VectorPushBackMove(GetBucket(hash_map, hash_map->buckets, vector_index),
+                               new_pair) == 0){
             return 0;
         }
     }
     hash_map->size++;
+    IndexPair(hash_map, new_pair);
+    if (hash_map->old_buckets) RehashStep(hash_map, HASH_MAP_REHASH_STEP);
     return 1;
 }
 
@@ -82,9 +315,10 @@ int HashMapInsert(HashMap *hash_map, Pair *pair){
  */
 int HashMapContainsKey(HashMap *hash_map, KeyT key){
     if (!hash_map || !key) return 0;
-    size_t vector_index = HASH(hash_map->hash_func, key, hash_map->capacity);
-    int pair_index = GetPairIndexByKey(hash_map->buckets[vector_index], key);
-    if (pair_index != -1) return 1;
+    int pair_index;
+    if (LocatePair(hash_map, key, KEY_HASH(hash_map->hash_func, key), &pair_index)){
+        return 1;
+    }
     return 0;
 }
 
@@ -95,15 +329,83 @@ int HashMapContainsKey(HashMap *hash_map, KeyT key){
  * @return the value associated with key if exists, NULL otherwise.
  */
 ValueT HashMapAt(HashMap *hash_map, KeyT key){
-    if (!hash_map || !key) return NULL;
-    size_t vector_index = HASH(hash_map->hash_func, key, hash_map->capacity);
-    int pair_index = GetPairIndexByKey(hash_map->buckets[vector_index], key);
-    if (pair_index < 0) return NULL;
-    Pair *pair = (Pair*) VectorAt(hash_map->buckets[vector_index], pair_index);
+    Pair *pair = HashMapGetPair(hash_map, key);
     if (!pair) return NULL;
     return pair->value;
 }
 
+/**
+ * The function looks up many keys at once. It is equal to calling HashMapAt
+ * for every key, but the keys are hashed first and the memory of their
+ * buckets and pairs is prefetched in stages, HASH_MAP_BATCH_SIZE keys at a
+ * time, so the cache misses of different keys overlap.
+ * @param hash_map a hash map.
+ * @param keys the keys to be checked.
+ * @param n the number of keys.
+ * @param out array of n values, out[i] is set to the value associated with
+ * keys[i] if exists, NULL otherwise.
+ * @return the number of keys found.
+ */
+size_t HashMapAtBatch(HashMap *hash_map, KeyT *keys, size_t n, ValueT *out){
+    if (!hash_map || !keys || !out) return 0;
+    size_t hashes[HASH_MAP_BATCH_SIZE];
+    Vector *buckets[HASH_MAP_BATCH_SIZE];
+    size_t found = 0;
+    for (size_t first = 0; first < n; first += HASH_MAP_BATCH_SIZE) {
+        size_t count = n - first < HASH_MAP_BATCH_SIZE ? n - first : HASH_MAP_BATCH_SIZE;
+        KeyT *batch = keys + first;
+        // the old buckets (while migrating) are not prefetched - LocatePair
+        // reaches them only for keys which are not moved yet.
+        for (size_t i = 0; i < count; ++i) {
+            if (!batch[i]) continue;
+            hashes[i] = KEY_HASH(hash_map->hash_func, batch[i]);
+            PREFETCH(&hash_map->buckets[BUCKET_INDEX(hashes[i], hash_map->capacity)]);
+        }
+        for (size_t i = 0; i < count; ++i) {
+            buckets[i] = NULL;
+            if (!batch[i]) continue;
+            buckets[i] = hash_map->buckets[BUCKET_INDEX(hashes[i], hash_map->capacity)];
+            if (buckets[i]) PREFETCH(buckets[i]);
+        }
+        for (size_t i = 0; i < count; ++i) {
+            if (buckets[i] && buckets[i]->size > 0) PREFETCH(buckets[i]->data);
+            else buckets[i] = NULL;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            if (buckets[i]) PREFETCH(buckets[i]->data[0]);
+        }
+        for (size_t i = 0; i < count; ++i) {
+            if (buckets[i]) PREFETCH(((Pair *) buckets[i]->data[0])->key);
+        }
+        for (size_t i = 0; i < count; ++i) {
+            out[first + i] = NULL;
+            if (!batch[i]) continue;
+            int pair_index;
+            Vector *bucket = LocatePair(hash_map, batch[i], hashes[i], &pair_index);
+            if (!bucket) continue;
+            out[first + i] = ((Pair *) bucket->data[pair_index])->value;
+            ++found;
+        }
+    }
+    return found;
+}
+
+/**
+ * The function returns the pair associated with the given key.
+ * @param hash_map a hash map.
+ * @param key the key to be checked.
+ * @return the pair (stored in the hash map, not a copy of it) associated with
+ * key if exists, NULL otherwise.
+ */
+Pair *HashMapGetPair(HashMap *hash_map, KeyT key){
+    if (!hash_map || !key) return NULL;
+    int pair_index;
+    Vector *bucket = LocatePair(hash_map, key, KEY_HASH(hash_map->hash_func, key),
+                                &pair_index);
+    if (!bucket) return NULL;
+    return (Pair*) bucket->data[pair_index];
+}
+
 /**
  * The function checks if the given value exists in the hash map.
  * @param hash_map a hash map.
@@ -114,12 +416,14 @@ int HashMapContainsValue(HashMap *hash_map, ValueT value){
     if (!hash_map || !value || hash_map->size == 0){
         return 0;
     }
-    for (size_t i = 0; i < hash_map->capacity; ++i) {
-        for (size_t j = 0; j < hash_map->buckets[i]->size; ++j) {
-            Pair *pair = (Pair*) hash_map->buckets[i]->data[j];
-            if (pair->value_cmp(pair->value, value) == 1){
-                return 1;
-            }
+    if (hash_map->value_index){
+        return ValueIndexFind(hash_map->value_index, value) != NULL;
+    }
+    HashMapIter iter;
+    HashMapIterBegin(hash_map, &iter);
+    for (Pair *pair = HashMapIterNext(&iter); pair; pair = HashMapIterNext(&iter)) {
+        if (pair->type->value_cmp(pair->value, value) == 1){
+            return 1;
         }
     }
     return 0;
@@ -146,24 +450,97 @@ void HashMapFree(HashMap **p_hash_map){
     for (size_t i = 0; i < (*p_hash_map)->capacity; ++i) {
         VectorFree(&(*p_hash_map)->buckets[i]);
     }
-    free((*p_hash_map)->buckets);
+    const Allocator *allocator = (*p_hash_map)->allocator;
+    ValueIndexFree(&(*p_hash_map)->value_index);
+    if ((*p_hash_map)->old_buckets){
+        FreeBuckets((*p_hash_map)->old_buckets, (*p_hash_map)->old_capacity);
+        AllocatorFree(allocator, (*p_hash_map)->old_buckets,
+                      (*p_hash_map)->old_capacity * sizeof(Vector *));
+        (*p_hash_map)->old_buckets = NULL;
+    }
+    AllocatorFree(allocator, (*p_hash_map)->buckets,
+                  (*p_hash_map)->capacity * sizeof(Vector *));
     (*p_hash_map)->buckets = NULL;
-    free(*p_hash_map);
+    AllocatorFree(allocator, *p_hash_map, sizeof(HashMap));
     *p_hash_map = NULL;
 }
 
 /**
  * This function deletes all the elements in the hash map.
+ * All the pairs are freed in one pass and the buckets are reset to
+ * HASH_MAP_INITIAL_CAP once (kept as is if the shrink policy is
+ * HASH_MAP_SHRINK_NEVER).
  * @param hash_map a hash map to be cleared.
  */
 void HashMapClear(HashMap *hash_map){
-    if (!hash_map || hash_map->size == 0) return;
-    for (long i = (long) hash_map->capacity - 1; i >= 0; --i) {
-        for (long j = (long) hash_map->buckets[i]->size - 1; j >= 0; --j) {
-            Pair* pair = (Pair*) hash_map->buckets[i]->data[j];
-            if (HashMapErase(hash_map, pair->key) == 0) return;
-        }
+    if (!hash_map) return;
+    ValueIndexClear(hash_map->value_index);
+    STATS_ADD(hash_map, pair_frees, hash_map->size);
+    FreeBuckets(hash_map->buckets, hash_map->capacity);
+    if (hash_map->old_buckets){
+        FreeBuckets(hash_map->old_buckets, hash_map->old_capacity);
+        AllocatorFree(hash_map->allocator, hash_map->old_buckets,
+                      hash_map->old_capacity * sizeof(Vector *));
+        hash_map->old_buckets = NULL;
+        hash_map->old_capacity = 0;
+        hash_map->rehash_index = 0;
+    }
+    hash_map->size = 0;
+    if (hash_map->shrink_policy == HASH_MAP_SHRINK_NEVER ||
+        hash_map->capacity == HASH_MAP_INITIAL_CAP){
+        return;
     }
+    Vector **temp = InitBuckets(hash_map->allocator, HASH_MAP_INITIAL_CAP);
+    if (!temp) return; // the (empty) old buckets are still valid.
+    STATS_RESIZE(hash_map, HASH_MAP_INITIAL_CAP);
+    AllocatorFree(hash_map->allocator, hash_map->buckets,
+                  hash_map->capacity * sizeof(Vector *));
+    hash_map->buckets = temp;
+    hash_map->capacity = HASH_MAP_INITIAL_CAP;
+}
+
+/**
+ * This function sets when the hash map minimizes its buckets after erasing.
+ * @param hash_map a hash map.
+ * @param policy the shrink policy.
+ */
+void HashMapSetShrinkPolicy(HashMap *hash_map, HashMapShrinkPolicy policy){
+    if (!hash_map) return;
+    hash_map->shrink_policy = policy;
+}
+
+/**
+ * This function minimizes the buckets of the hash map (in a single rehash)
+ * to the smallest capacity which holds its elements under
+ * HASH_MAP_MAX_LOAD_FACTOR, but not below HASH_MAP_INITIAL_CAP.
+ * @param hash_map a hash map.
+ * @return 1 for success, 0 otherwise.
+ */
+int HashMapShrinkToFit(HashMap *hash_map){
+    if (!hash_map) return 0;
+    if (FinishRehash(hash_map) == 0) return 0;
+    size_t new_cap = CapacityFor(hash_map->size, HASH_MAP_MAX_LOAD_FACTOR);
+    if (new_cap == 0 || new_cap >= hash_map->capacity) return 1;
+    return ResizeTable(hash_map, new_cap);
+}
+
+/**
+ * This function sets whether the hash map grows incrementally.
+ * When enabled, growing the buckets only allocates the new buckets, and every
+ * insert or erase afterwards moves HASH_MAP_REHASH_STEP buckets from the old
+ * buckets to the new ones (lookups check both meanwhile), so no single insert
+ * rehashes the whole hash map. Disabling it finishes an ongoing migration
+ * first; if that fails, the hash map stays incremental (and 0 is returned).
+ * @param hash_map a hash map.
+ * @param enabled 1 to enable, 0 to disable.
+ * @return 1 for success, 0 otherwise.
+ */
+int HashMapSetIncrementalRehash(HashMap *hash_map, int enabled){
+    if (!hash_map) return 0;
+    // the eager resizes ignore old buckets, so they must be drained first.
+    if (!enabled && FinishRehash(hash_map) == 0) return 0;
+    hash_map->incremental_rehash = enabled;
+    return 1;
 }
 
 /**
@@ -174,51 +551,174 @@ void HashMapClear(HashMap *hash_map){
  */
 int HashMapErase(HashMap *hash_map, KeyT key){
     if (!hash_map || !key) return 0;
-    if (HashMapContainsKey(hash_map, key) == 0) return 0;
-    size_t vector_index = HASH(hash_map->hash_func, key, hash_map->capacity);
-    int pair_index = GetPairIndexByKey(hash_map->buckets[vector_index], key);
-    if (pair_index == -1) return 0;
-    if (VectorErase(hash_map->buckets[vector_index], pair_index) == 0) return 0;
+    int pair_index;
+    Vector *bucket = LocatePair(hash_map, key, KEY_HASH(hash_map->hash_func, key),
+                                &pair_index);
+    if (!bucket) return 0;
+    // take the pair out first, so it is unindexed only once it is gone.
+    Pair *pair = (Pair *) VectorTakeAt(bucket, pair_index);
+    UnindexPair(hash_map, pair);
+    hash_map->pair_free((void **) &pair);
+    STATS_ADD(hash_map, pair_frees, 1);
     --hash_map->size;
-    return DecreaseTable(hash_map, hash_map->capacity / HASH_MAP_GROWTH_FACTOR);
+    return AfterErase(hash_map);
 }
 
-/*
- * This function creates buckets and allocates its vectors. Returns the buckets
- * and NULL for failure
+/**
+ * The function removes the pair associated with key from the hash map
+ * *without* freeing it, and returns it (one lookup, like HashMapErase).
+ * @param hash_map a hash map.
+ * @param key a key of the pair to be removed.
+ * @return the removed pair (the caller owns it and frees it, with the
+ * pair_free of the hash map), NULL if there is no such key.
+ */
+Pair *HashMapEraseAndGet(HashMap *hash_map, KeyT key){
+    if (!hash_map || !key) return NULL;
+    int pair_index;
+    Vector *bucket = LocatePair(hash_map, key, KEY_HASH(hash_map->hash_func, key),
+                                &pair_index);
+    if (!bucket) return NULL;
+    Pair *pair = (Pair *) VectorTakeAt(bucket, pair_index);
+    UnindexPair(hash_map, pair);
+    --hash_map->size;
+    AfterErase(hash_map); // on failure the buckets are still valid.
+    return pair;
+}
+
+/**
+ * The function returns the value associated with the key of the given pair,
+ * and inserts a copy of the pair first if the key is not in the hash map.
+ * The key is hashed and looked up once.
+ * @param hash_map a hash map.
+ * @param pair the pair to be inserted if its key is missing.
+ * @return the value (stored in the hash map) associated with the key,
+ * NULL for failure.
  */
-Vector ** InitBuckets(size_t size, VectorElemCpy cpy_func, VectorElemCmp cmp_func,
-                      VectorElemFree free_func){
-    Vector **buckets = calloc(1, size * sizeof(Vector*));
-    if (!buckets){
+ValueT HashMapFindOrInsert(HashMap *hash_map, Pair *pair){
+    if (!hash_map || !pair) return NULL;
+    size_t hash = KEY_HASH(hash_map->hash_func, pair->key);
+    int pair_index;
+    Vector *bucket = LocatePair(hash_map, pair->key, hash, &pair_index);
+    if (bucket) return ((Pair *) bucket->data[pair_index])->value;
+    Pair *new_pair = CopyPair(hash_map, pair, hash);
+    if (!new_pair) return NULL;
+    if (InsertNewHashed(hash_map, new_pair, hash) == 0){
+        hash_map->pair_free((void **) &new_pair);
         return NULL;
     }
-    for (size_t i = 0; i < size; ++i) {
-        buckets[i] = VectorAlloc(cpy_func, cmp_func, free_func);
-        if (!buckets[i]){
-            FreeBuckets(buckets, size);
-            free(buckets);
-            return NULL;
+    return new_pair->value;
+}
+
+/**
+ * The function inserts a copy of the pair if its key is not in the hash map,
+ * otherwise it merges the value of the pair into the existing value.
+ * The key is hashed and looked up once.
+ * @param hash_map a hash map.
+ * @param pair the pair to be inserted or merged.
+ * @param merge a function which merges the new value into the existing one.
+ * @param ctx a context passed to merge.
+ * @return 1 for success, 0 otherwise.
+ */
+int HashMapUpsert(HashMap *hash_map, Pair *pair, HashMapMerge merge, void *ctx){
+    if (!hash_map || !pair || !merge) return 0;
+    size_t hash = KEY_HASH(hash_map->hash_func, pair->key);
+    int pair_index;
+    Vector *bucket = LocatePair(hash_map, pair->key, hash, &pair_index);
+    if (bucket){
+        Pair *exist_pair = (Pair *) bucket->data[pair_index];
+        UnindexPair(hash_map, exist_pair); // merge may change the value in place.
+        ValueT merged = merge(exist_pair->value, pair->value, ctx);
+        if (merged && merged != exist_pair->value){
+            PairFreeValue(exist_pair->type, &exist_pair->value);
+            exist_pair->value = merged;
         }
+        IndexPair(hash_map, exist_pair);
+        return merged != NULL;
+    }
+    Pair *new_pair = CopyPair(hash_map, pair, hash);
+    if (!new_pair) return 0;
+    if (InsertNewHashed(hash_map, new_pair, hash) == 0){
+        hash_map->pair_free((void **) &new_pair);
+        return 0;
+    }
+    return 1;
+}
+
+/*
+ * This function continues the migration or decreases the buckets (if
+ * needed) after a pair was removed. Return 1 for success, 0 for failure
+ */
+int AfterErase(HashMap *hash_map){
+    if (hash_map->old_buckets) return RehashStep(hash_map, HASH_MAP_REHASH_STEP);
+    return DecreaseTable(hash_map);
+}
+
+/*
+ * This function creates empty buckets. The vectors are not allocated here,
+ * each bucket stays NULL until a pair is inserted into it (see GetBucket).
+ * Returns the buckets and NULL for failure
+ */
+Vector ** InitBuckets(const Allocator *allocator, size_t size){
+    return AllocatorCalloc(allocator, size * sizeof(Vector*));
+}
+
+/*
+ * This function returns the vector of the bucket at the given index, and
+ * allocates it if the bucket is still empty. Returns NULL for failure.
+ */
+Vector *GetBucket(HashMap *hash_map, Vector **buckets, size_t ind){
+    if (!buckets[ind]){
+        buckets[ind] = VectorAllocWith(hash_map->pair_cpy, hash_map->pair_cmp,
+                                       hash_map->pair_free, hash_map->allocator);
     }
-    return buckets;
+    return buckets[ind];
 }
 
 /*
- * This function gets a key to find in the input vector. It returns the index of
- * that key in the vector. If not found returns -1 for.
+ * This function gets a key (and its hash) to find in the input vector. It
+ * returns the index of that key in the vector. If not found returns -1 for.
+ * The keys are compared only if the cached hashes are equal.
  */
-int GetPairIndexByKey(Vector * vec, KeyT key){
+int GetPairIndexByKey(Vector * vec, KeyT key, size_t hash){
     if (!vec || !key) return -1;
     for (size_t i = 0; i < vec->size; ++i) {
         Pair *p = (Pair*) vec->data[i];
-        if (p->key_cmp(p->key, key) == 1){
+        if (p->hash == hash && p->type->key_cmp(p->key, key) == 1){
             return i;
         }
     }
     return -1;
 }
 
+/*
+ * This function copies the pair with the copy func of the hashmap and caches
+ * the hash of its key in the copy. Returns NULL for failure.
+ */
+Pair *CopyPair(HashMap *hash_map, Pair *pair, size_t hash){
+    Pair *new_pair = (Pair *) hash_map->pair_cpy(pair);
+    if (new_pair) new_pair->hash = hash;
+    STATS_ADD(hash_map, pair_copies, 1);
+    return new_pair;
+}
+
+/*
+ * This function finds the pair with the given key (and its hash), in the
+ * buckets and (while migrating) in the old buckets. Returns the vector which
+ * holds the pair and sets pair_index to its index, NULL if not found.
+ */
+Vector *LocatePair(HashMap *hash_map, KeyT key, size_t hash, int *pair_index){
+    Vector *bucket = hash_map->buckets[BUCKET_INDEX(hash, hash_map->capacity)];
+    *pair_index = GetPairIndexByKey(bucket, key, hash);
+    STATS_PROBES(hash_map, bucket, *pair_index, 1);
+    if (*pair_index != -1) return bucket;
+    if (!hash_map->old_buckets) return NULL;
+    bucket = hash_map->old_buckets[BUCKET_INDEX(hash, hash_map->old_capacity)];
+    *pair_index = GetPairIndexByKey(bucket, key, hash);
+    STATS_PROBES(hash_map, bucket, *pair_index, 0);
+    if (*pair_index != -1) return bucket;
+    return NULL;
+}
+
 /*
  * This function free the vectors in the input buckets
  */
@@ -230,40 +730,75 @@ void FreeBuckets(Vector** buckets, size_t size){
 }
 
 /*
- * This function adds a pair to the hashmap when needed to increase the buckets
- * first. When increased it also rehash all items again and frees the old
- * buckets. Return 1 for success, 0 for failure
+ * This function free the vectors in the input buckets without freeing the
+ * pairs stored in them (the pairs were moved to other buckets).
+ */
+void ReleaseBuckets(Vector** buckets, size_t size){
+    for (size_t i = 0; i < size; ++i) {
+        VectorRelease(&buckets[i]);
+    }
+}
+
+/*
+ * This function adds a (new, owned) pair to the hashmap when needed to increase
+ * the buckets first. When increased it also rehash all items again and frees
+ * the old buckets. Return 1 for success, 0 for failure (the pair is not freed)
  */
-int IncreaseTable(HashMap *hash_map, size_t new_cap, Pair* pair){
+int IncreaseTable(HashMap *hash_map, size_t new_cap, Pair* new_pair){
     Vector **temp = ReHashing(hash_map, new_cap);
     if (!temp){
         return 0;
     }
-    size_t ind = HASH(hash_map->hash_func, pair->key, new_cap);
-    if (VectorPushBack(temp[ind], pair) == 0){
-        FreeBuckets(temp, new_cap);
-        free(temp);
+    size_t ind = BUCKET_INDEX(new_pair->hash, new_cap);
+    if (VectorPushBackMove(GetBucket(hash_map, temp, ind), new_pair) == 0){
+        ReleaseBuckets(temp, new_cap);
+        AllocatorFree(hash_map->allocator, temp, new_cap * sizeof(Vector *));
         return 0;
     }
-    FreeBuckets(hash_map->buckets, hash_map->capacity);
-    free(hash_map->buckets);
+    STATS_RESIZE(hash_map, new_cap);
+    ReleaseBuckets(hash_map->buckets, hash_map->capacity);
+    AllocatorFree(hash_map->allocator, hash_map->buckets,
+                  hash_map->capacity * sizeof(Vector *));
     hash_map->capacity = new_cap;
     hash_map->buckets = temp;
     return 1;
 }
 
 /*
- * This function decrease the buckets if needed. It rehash all items again and
- * frees the old buckets. Return 1 for success, 0 for failure
+ * This function decrease the buckets if needed, according to the shrink policy
+ * of the hashmap. Return 1 for success, 0 for failure
+ */
+int DecreaseTable(HashMap *hash_map){
+    size_t new_cap;
+    switch (hash_map->shrink_policy) {
+        case HASH_MAP_SHRINK_NEVER:
+            return 1;
+        case HASH_MAP_SHRINK_HYSTERESIS:
+            if (HashMapGetLoadFactor(hash_map) >= HASH_MAP_HYSTERESIS_LOAD_FACTOR) return 1;
+            new_cap = CapacityFor(hash_map->size, HASH_MAP_SHRINK_TARGET_LOAD_FACTOR);
+            break;
+        default:
+            if (HashMapGetLoadFactor(hash_map) >= HASH_MAP_MIN_LOAD_FACTOR) return 1;
+            new_cap = hash_map->capacity / HASH_MAP_GROWTH_FACTOR;
+            break;
+    }
+    if (new_cap == 0 || new_cap >= hash_map->capacity) return 1;
+    return ResizeTable(hash_map, new_cap);
+}
+
+/*
+ * This function rehash all items again into new_cap buckets and frees the old
+ * buckets. Return 1 for success, 0 for failure
  */
-int DecreaseTable(HashMap *hash_map, size_t new_cap){
-    if (HashMapGetLoadFactor(hash_map) >= HASH_MAP_MIN_LOAD_FACTOR) return 1;
+int ResizeTable(HashMap *hash_map, size_t new_cap){
     Vector **temp = ReHashing(hash_map, new_cap);
     if (!temp){
         return 0;
     }
-    FreeBuckets(hash_map->buckets, hash_map->capacity);
-    free(hash_map->buckets);
+    STATS_RESIZE(hash_map, new_cap);
+    ReleaseBuckets(hash_map->buckets, hash_map->capacity);
+    AllocatorFree(hash_map->allocator, hash_map->buckets,
+                  hash_map->capacity * sizeof(Vector *));
     hash_map->capacity = new_cap;
     hash_map->buckets = temp;
     return 1;
@@ -272,22 +807,384 @@ int DecreaseTable(HashMap *hash_map, size_t new_cap){
 /*
  * This function rehash the buckets of the input hashmap to a new buckets with
  * the input size (either increase or decrease). It returns the new buckets.
+ * The pairs are moved (not copied), so the old buckets must be released with
+ * ReleaseBuckets and not freed.
  */
 Vector **ReHashing(HashMap *hash_map, size_t new_cap){
-    Vector **temp = InitBuckets(new_cap, hash_map->pair_cpy, hash_map->pair_cmp, hash_map->pair_free);
+    Vector **temp = InitBuckets(hash_map->allocator, new_cap);
     if (!temp){
         return NULL;
     }
+    STATS_START(start);
+    STATS_ADD(hash_map, rehashed_pairs, hash_map->size);
     for (size_t i = 0; i < hash_map->capacity; ++i) {
+        if (!hash_map->buckets[i]) continue;
         for (size_t j = 0; j < hash_map->buckets[i]->size; ++j) {
             Pair* exist_pair = (Pair *) hash_map->buckets[i]->data[j];
-            size_t new_ind = HASH(hash_map->hash_func, exist_pair->key, new_cap);
-            if(VectorPushBack(temp[new_ind], exist_pair) == 0){
-                FreeBuckets(temp, new_cap);
-                free(temp);
+            size_t new_ind = BUCKET_INDEX(exist_pair->hash, new_cap);
+            if(VectorPushBackMove(GetBucket(hash_map, temp, new_ind), exist_pair) == 0){
+                ReleaseBuckets(temp, new_cap);
+                AllocatorFree(hash_map->allocator, temp, new_cap * sizeof(Vector *));
                 return NULL;
             }
         }
     }
+    STATS_TIME(hash_map, start);
     return temp;
 }
+
+/*
+ * This function returns the smallest capacity (a power of 2, at least
+ * HASH_MAP_INITIAL_CAP) which holds size elements under the given load factor.
+ * Returns 0 if there is no such capacity (the array of its buckets would not
+ * fit in size_t).
+ */
+size_t CapacityFor(size_t size, double load_factor){
+    size_t cap = HASH_MAP_INITIAL_CAP;
+    while (cap * load_factor < (double) size){
+        if (cap > SIZE_MAX / HASH_MAP_GROWTH_FACTOR / sizeof(Vector *)) return 0;
+        cap *= HASH_MAP_GROWTH_FACTOR;
+    }
+    return cap;
+}
+
+/*
+ * This function starts an incremental migration to new_cap buckets: the
+ * current buckets become the old buckets, and the pairs are moved from them
+ * by RehashStep. Return 1 for success, 0 for failure
+ */
+int StartRehash(HashMap *hash_map, size_t new_cap){
+    Vector **temp = InitBuckets(hash_map->allocator, new_cap);
+    if (!temp) return 0;
+    STATS_RESIZE(hash_map, new_cap);
+    hash_map->old_buckets = hash_map->buckets;
+    hash_map->old_capacity = hash_map->capacity;
+    hash_map->rehash_index = 0;
+    hash_map->buckets = temp;
+    hash_map->capacity = new_cap;
+    return 1;
+}
+
+/*
+ * This function moves (up to) steps old buckets to the buckets, visiting at
+ * most HASH_MAP_REHASH_EMPTY_VISITS empty buckets per step. When all the old
+ * buckets were moved, they are freed. Return 1 for success, 0 for failure
+ */
+int RehashStep(HashMap *hash_map, size_t steps){
+    size_t empty_visits = steps > (size_t) -1 / HASH_MAP_REHASH_EMPTY_VISITS ?
+                          (size_t) -1 : steps * HASH_MAP_REHASH_EMPTY_VISITS;
+    STATS_START(start);
+    while (steps > 0 && hash_map->rehash_index < hash_map->old_capacity){
+        Vector **old_bucket = &hash_map->old_buckets[hash_map->rehash_index];
+        if (!(*old_bucket)){
+            hash_map->rehash_index++;
+            if (--empty_visits == 0) break;
+            continue;
+        }
+        // moved from the back, so a failure leaves every pair in one place.
+        while ((*old_bucket)->size > 0){
+            Pair *exist_pair = (Pair *) (*old_bucket)->data[(*old_bucket)->size - 1];
+            size_t new_ind = BUCKET_INDEX(exist_pair->hash, hash_map->capacity);
+            if (VectorPushBackMove(GetBucket(hash_map, hash_map->buckets, new_ind),
+                                   exist_pair) == 0){
+                STATS_TIME(hash_map, start);
+                return 0;
+            }
+            (*old_bucket)->size--;
+            STATS_ADD(hash_map, rehashed_pairs, 1);
+        }
+        VectorRelease(old_bucket);
+        hash_map->rehash_index++;
+        steps--;
+    }
+    if (hash_map->rehash_index >= hash_map->old_capacity){
+        AllocatorFree(hash_map->allocator, hash_map->old_buckets,
+                      hash_map->old_capacity * sizeof(Vector *));
+        hash_map->old_buckets = NULL;
+        hash_map->old_capacity = 0;
+        hash_map->rehash_index = 0;
+    }
+    STATS_TIME(hash_map, start);
+    return 1;
+}
+
+/*
+ * This function finishes an ongoing migration (if any) at once.
+ * Return 1 for success, 0 for failure
+ */
+int FinishRehash(HashMap *hash_map){
+    if (!hash_map->old_buckets) return 1;
+    return RehashStep(hash_map, (size_t) -1);
+}
+
+/**
+ * This function sets the iterator to the first pair of the hash map.
+ * The order of the pairs is unspecified. The iterator stays valid as long as
+ * the hash map is not modified (lookups never move pairs, also while the hash
+ * map grows incrementally).
+ * @param hash_map a hash map.
+ * @param iter the iterator to be set.
+ * @return 1 for success, 0 otherwise.
+ */
+int HashMapIterBegin(HashMap *hash_map, HashMapIter *iter){
+    if (!hash_map || !iter) return 0;
+    iter->hash_map = hash_map;
+    iter->bucket = 0;
+    iter->index = 0;
+    return 1;
+}
+
+/**
+ * This function returns the next pair of the iteration.
+ * @param iter an iterator set by HashMapIterBegin.
+ * @return the next pair (the pair itself, not a copy of it), NULL if all the
+ * pairs were visited.
+ */
+Pair *HashMapIterNext(HashMapIter *iter){
+    if (!iter || !iter->hash_map) return NULL;
+    HashMap *hash_map = iter->hash_map;
+    size_t total = hash_map->capacity + hash_map->old_capacity;
+    for (; iter->bucket < total; ++iter->bucket, iter->index = 0) {
+        size_t count;
+        Vector *bucket = BucketsOf(hash_map, iter->bucket, &count)[iter->bucket - count];
+        if (bucket && iter->index < bucket->size){
+            return (Pair *) bucket->data[iter->index++];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * This function calls visit on every pair of the hash map, bucket by bucket.
+ * The hash map must not be modified during the call (the pairs may be).
+ * @param hash_map a hash map.
+ * @param visit a function which is called with every pair and ctx, returns 0
+ * to stop.
+ * @param ctx a context passed to visit.
+ * @return 1 if all the pairs were visited, 0 otherwise.
+ */
+int HashMapForEach(HashMap *hash_map, HashMapVisit visit, void *ctx){
+    if (!hash_map || !visit) return 0;
+    Vector **tables[2] = {hash_map->buckets, hash_map->old_buckets};
+    size_t capacities[2] = {hash_map->capacity, hash_map->old_capacity};
+    for (int t = 0; t < 2; ++t) {
+        Vector **buckets = tables[t];
+        for (size_t i = 0; i < capacities[t]; ++i) {
+            Vector *bucket = buckets[i];
+            if (!bucket) continue;
+            void **data = bucket->data, **end = data + bucket->size;
+            for (; data < end; ++data) {
+                if (visit((Pair *) *data, ctx) == 0) return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+/*
+ * This function returns the buckets array which holds the given bucket of
+ * an iteration (the new buckets, then the old ones), and sets count to the
+ * number of iterated buckets before that array.
+ */
+Vector **BucketsOf(HashMap *hash_map, size_t bucket, size_t *count){
+    if (bucket < hash_map->capacity){
+        *count = 0;
+        return hash_map->buckets;
+    }
+    *count = hash_map->capacity;
+    return hash_map->old_buckets;
+}
+
+/**
+ * This function enables (or disables) the reverse value index of the hash map.
+ * While enabled, every pair is indexed by its value as well (one pointer per
+ * pair and a bucket array), so HashMapContainsValue, HashMapKeyOf and
+ * HashMapCountValue do not scan the hash map.
+ * Values changed through the hash map (HashMapUpdateValue, HashMapUpsert) are
+ * re-indexed; a value must not be changed directly (e.g. through HashMapAt)
+ * while the index is enabled. If the index fails to allocate, it is dropped
+ * and the functions scan again.
+ * @param hash_map a hash map.
+ * @param value_hash a function which "hashes" values, NULL to disable.
+ * @return 1 for success, 0 otherwise.
+ */
+int HashMapSetValueIndex(HashMap *hash_map, HashFunc value_hash){
+    if (!hash_map) return 0;
+    ValueIndexFree(&hash_map->value_index);
+    if (!value_hash) return 1;
+    ValueIndex *index = ValueIndexAlloc(value_hash, hash_map->allocator);
+    if (!index) return 0;
+    HashMapIter iter;
+    HashMapIterBegin(hash_map, &iter);
+    for (Pair *pair = HashMapIterNext(&iter); pair; pair = HashMapIterNext(&iter)) {
+        if (ValueIndexAdd(index, pair) == 0){
+            ValueIndexFree(&index);
+            return 0;
+        }
+    }
+    hash_map->value_index = index;
+    return 1;
+}
+
+/**
+ * The function returns a key associated with the given value (reverse lookup).
+ * @param hash_map a hash map.
+ * @param value the value to look for.
+ * @return the key (stored in the hash map) of a pair with this value, NULL if
+ * there is none.
+ */
+KeyT HashMapKeyOf(HashMap *hash_map, ValueT value){
+    if (!hash_map || !value) return NULL;
+    if (hash_map->value_index){
+        Pair *pair = ValueIndexFind(hash_map->value_index, value);
+        return pair ? pair->key : NULL;
+    }
+    HashMapIter iter;
+    HashMapIterBegin(hash_map, &iter);
+    for (Pair *pair = HashMapIterNext(&iter); pair; pair = HashMapIterNext(&iter)) {
+        if (pair->type->value_cmp(pair->value, value) == 1) return pair->key;
+    }
+    return NULL;
+}
+
+/**
+ * The function counts the pairs associated with the given value.
+ * @param hash_map a hash map.
+ * @param value the value to look for.
+ * @return the number of pairs with this value.
+ */
+size_t HashMapCountValue(HashMap *hash_map, ValueT value){
+    if (!hash_map || !value) return 0;
+    if (hash_map->value_index) return ValueIndexCount(hash_map->value_index, value);
+    ValueCount value_count = {value, 0};
+    HashMapForEach(hash_map, CountPairValue, &value_count);
+    return value_count.count;
+}
+
+/*
+ * HashMapForEach visitor which counts the pairs with the value of ctx
+ * (a ValueCount).
+ */
+int CountPairValue(Pair *pair, void *ctx){
+    ValueCount *value_count = (ValueCount *) ctx;
+    if (pair->type->value_cmp(pair->value, value_count->value) == 1){
+        value_count->count++;
+    }
+    return 1;
+}
+
+/*
+ * This function adds the pair to the value index (if enabled). If the index
+ * fails, it is dropped, so the value functions fall back to scanning.
+ */
+void IndexPair(HashMap *hash_map, Pair *pair){
+    if (!hash_map->value_index) return;
+    if (ValueIndexAdd(hash_map->value_index, pair) == 0){
+        ValueIndexFree(&hash_map->value_index);
+    }
+}
+
+/*
+ * This function removes the pair from the value index (if enabled), before
+ * its value is changed or freed.
+ */
+void UnindexPair(HashMap *hash_map, Pair *pair){
+    if (!hash_map->value_index) return;
+    ValueIndexRemove(hash_map->value_index, pair);
+}
+
+/**
+ * This function fills stats with the counters of the hash map (zero unless
+ * the library is built with HASH_MAP_STATS) and with the current shape of
+ * its buckets (always).
+ * @param hash_map a hash map.
+ * @param stats the stats to be filled.
+ * @return 1 for success, 0 otherwise.
+ */
+int HashMapGetStats(HashMap *hash_map, HashMapStats *stats){
+    if (!hash_map || !stats) return 0;
+#ifdef HASH_MAP_STATS
+    *stats = hash_map->stats;
+    stats->lookups = __atomic_load_n(&hash_map->stats.lookups, __ATOMIC_RELAXED);
+    stats->probes = __atomic_load_n(&hash_map->stats.probes, __ATOMIC_RELAXED);
+    stats->max_probes = __atomic_load_n(&hash_map->stats.max_probes, __ATOMIC_RELAXED);
+#else
+    memset(stats, 0, sizeof(HashMapStats));
+#endif
+    stats->size = hash_map->size;
+    stats->capacity = hash_map->capacity;
+    stats->used_buckets = 0;
+    stats->max_bucket_len = 0;
+    for (size_t i = 0; i < hash_map->capacity + hash_map->old_capacity; ++i) {
+        size_t count;
+        Vector *bucket = BucketsOf(hash_map, i, &count)[i - count];
+        if (!bucket || bucket->size == 0) continue;
+        stats->used_buckets++;
+        if (bucket->size > stats->max_bucket_len) stats->max_bucket_len = bucket->size;
+    }
+    stats->mean_bucket_len = stats->used_buckets == 0 ? 0 :
+                             (double) hash_map->size / (double) stats->used_buckets;
+    return 1;
+}
+
+/**
+ * This function resets the counters of the hash map (see HashMapGetStats).
+ * @param hash_map a hash map.
+ */
+void HashMapResetStats(HashMap *hash_map){
+    if (!hash_map) return;
+#ifdef HASH_MAP_STATS
+    memset(&hash_map->stats, 0, sizeof(HashMapStats));
+#endif
+}
+
+/**
+ * This function fills a histogram of the bucket lengths of the hash map:
+ * histogram[i] is the number of buckets with i pairs, and the last bin
+ * counts all the buckets with bins-1 pairs or more.
+ * @param hash_map a hash map.
+ * @param histogram array of bins counters to be filled.
+ * @param bins the number of bins (at least 1).
+ * @return 1 for success, 0 otherwise.
+ */
+int HashMapGetBucketHistogram(HashMap *hash_map, size_t *histogram, size_t bins){
+    if (!hash_map || !histogram || bins == 0) return 0;
+    memset(histogram, 0, bins * sizeof(size_t));
+    for (size_t i = 0; i < hash_map->capacity + hash_map->old_capacity; ++i) {
+        size_t count;
+        Vector *bucket = BucketsOf(hash_map, i, &count)[i - count];
+        size_t len = bucket ? bucket->size : 0;
+        histogram[len < bins ? len : bins - 1]++;
+    }
+    return 1;
+}
+
+#ifdef HASH_MAP_STATS
+/*
+ * This function returns the time (seconds) of the monotonic clock - the wall
+ * time of the calling thread's work, unlike clock() which sums the processor
+ * time of all the threads (and is a system call on every rehash step).
+ */
+double StatsNow(void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) now.tv_sec + (double) now.tv_nsec / 1e9;
+}
+
+/*
+ * This function counts a scan of a bucket (lookups is 1 for the first bucket
+ * of a lookup, 0 for the old bucket of the same lookup). The counters are
+ * relaxed atomics, since read-only lookups may run in parallel.
+ */
+void CountProbes(HashMap *hash_map, Vector *bucket, int pair_index, size_t lookups){
+    size_t probes = pair_index != -1 ? (size_t) pair_index + 1 : (bucket ? bucket->size : 0);
+    // lookups may run concurrently (e.g. under the read lock of a segment).
+    __atomic_fetch_add(&hash_map->stats.lookups, lookups, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&hash_map->stats.probes, probes, __ATOMIC_RELAXED);
+    size_t max_probes = __atomic_load_n(&hash_map->stats.max_probes, __ATOMIC_RELAXED);
+    while (probes > max_probes &&
+           !__atomic_compare_exchange_n(&hash_map->stats.max_probes, &max_probes, probes, 1,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+#endif
@@ -4,6 +4,7 @@
 #include <stdlib.h>
 #include "Vector.h"
 #include "Pair.h"
+#include "ValueIndex.h"
 
 /**
  * @def HASH_MAP_INITIAL_CAP
@@ -41,13 +42,67 @@
  */
 #define HASH_MAP_MAX_LOAD_FACTOR 0.75
 
+/**
+ * @def HASH_MAP_HYSTERESIS_LOAD_FACTOR
+ * The load factor the hash map has to drop below before it is minimized,
+ * when the shrink policy is HASH_MAP_SHRINK_HYSTERESIS.
+ */
+#define HASH_MAP_HYSTERESIS_LOAD_FACTOR 0.125
+
+/**
+ * @def HASH_MAP_SHRINK_TARGET_LOAD_FACTOR
+ * The load factor the hash map is minimized to (in a single rehash),
+ * when the shrink policy is HASH_MAP_SHRINK_HYSTERESIS.
+ */
+#define HASH_MAP_SHRINK_TARGET_LOAD_FACTOR 0.5
+
+/**
+ * @def HASH_MAP_REHASH_STEP
+ * The number of buckets moved by every insert or erase while the hash map
+ * grows incrementally (see HashMapSetIncrementalRehash).
+ */
+#define HASH_MAP_REHASH_STEP 4UL
+
+/**
+ * @def HASH_MAP_REHASH_EMPTY_VISITS
+ * The number of empty old buckets which count as one rehash step.
+ */
+#define HASH_MAP_REHASH_EMPTY_VISITS 10UL
+
+/**
+ * @def HASH_MAP_BATCH_SIZE
+ * The number of keys HashMapAtBatch keeps in flight - every stage of the
+ * lookup (bucket slot, bucket vector, its data, the first pair and its key)
+ * is prefetched for all of them before the next stage reads it.
+ */
+#define HASH_MAP_BATCH_SIZE 16UL
+
+/**
+ * @enum HashMapShrinkPolicy
+ * When the hash map minimizes its buckets after erasing.
+ * HASH_MAP_SHRINK_EAGER - the buckets are halved as soon as the load factor
+ * drops below HASH_MAP_MIN_LOAD_FACTOR (the default).
+ * HASH_MAP_SHRINK_HYSTERESIS - the buckets are minimized only when the load
+ * factor drops below HASH_MAP_HYSTERESIS_LOAD_FACTOR, and then straight to
+ * HASH_MAP_SHRINK_TARGET_LOAD_FACTOR, so erase/insert around a threshold
+ * does not rehash back and forth.
+ * HASH_MAP_SHRINK_NEVER - erasing never minimizes the buckets,
+ * use HashMapShrinkToFit explicitly.
+ */
+typedef enum HashMapShrinkPolicy {
+  HASH_MAP_SHRINK_EAGER,
+  HASH_MAP_SHRINK_HYSTERESIS,
+  HASH_MAP_SHRINK_NEVER
+} HashMapShrinkPolicy;
+
 /**
  * @typedef HashFunc
  * This type of function receives a KeyT and returns
  * a representational number of it.
  * Example: lets say we have a pair ('Joe', 78) that we want to store in the hash map,
  * the key is 'Joe' so it determines the bucket in the hash map,
- * his index would be:  size_t ind = HashFunc('Joe') & (capacity - 1);
+ * his index would be:  size_t ind = HashFinalize(HashFunc('Joe')) & (capacity - 1);
+ * (HashFinalize, from Hash.h, mixes the bits so weak hash funcs spread well).
  */
 typedef size_t (*HashFunc)(KeyT);
 
@@ -69,15 +124,79 @@ typedef int (*HashMapPairCmp)(const void *, const void *);
  */
 typedef void (*HashMapPairFree)(void **);
 
+/**
+ * @typedef HashMapMerge
+ * A function which receives the value stored in the hash map, a new value for
+ * the same key and a context, and returns the merged value: either the stored
+ * value itself (updated in place), or a new value allocated like the values of
+ * the pair type (e.g. PairCopyValue) which replaces it (the stored value is
+ * then freed with PairFreeValue). NULL means failure.
+ * Example (counters): *(int *) stored += *(int *) new_value; return stored;
+ */
+typedef ValueT (*HashMapMerge)(ValueT, ValueT, void *);
+
+/**
+ * @struct HashMapStats
+ * Statistics of a hash map (see HashMapGetStats).
+ * The counters are only counted when the library is built with
+ * HASH_MAP_STATS defined (the CMake option HASH_MAP_STATS); otherwise they
+ * cost nothing and stay zero. The lookup counters (lookups, probes,
+ * max_probes) are atomic, so concurrent readers may update them; all the
+ * others, HashMapGetStats and HashMapResetStats are single-writer - they
+ * must not run in parallel with a writer of the hash map.
+ * @param lookups the number of key lookups (by any function).
+ * @param probes the number of pairs the lookups passed over, in total.
+ * @param max_probes the most pairs a single bucket scan passed over.
+ * @param grows the number of times the buckets were increased.
+ * @param shrinks the number of times the buckets were decreased.
+ * @param rehashed_pairs the number of pairs moved between buckets.
+ * @param rehash_time the time (seconds, monotonic clock) spent moving them.
+ * @param pair_copies the number of pairs copied by pair_cpy.
+ * @param pair_frees the number of stored pairs freed by pair_free.
+ * The rest is computed from the buckets by HashMapGetStats:
+ * @param size, capacity the size and the number of (new) buckets.
+ * @param used_buckets the number of non-empty buckets.
+ * @param max_bucket_len the length of the longest bucket.
+ * @param mean_bucket_len the mean length of the non-empty buckets.
+ */
+typedef struct HashMapStats {
+  size_t lookups;
+  size_t probes;
+  size_t max_probes;
+  size_t grows;
+  size_t shrinks;
+  size_t rehashed_pairs;
+  double rehash_time;
+  size_t pair_copies;
+  size_t pair_frees;
+  size_t size;
+  size_t capacity;
+  size_t used_buckets;
+  size_t max_bucket_len;
+  double mean_bucket_len;
+} HashMapStats;
+
 /**
  * @struct HashMap
  * @param buckets dynamic array of vectors which stores the values.
+ * A bucket is NULL until the first pair is inserted into it.
  * @param size the number of elements (pairs) stored in the hash map.
  * @param capacity the number of buckets in the hash map.
  * @param hash_func a function which "hashes" keys.
  * @param pair_cpy a function which copies pairs.
  * @param pair_cmp a function which compares pairs.
  * @param pair_free a function which frees pairs.
+ * @param shrink_policy when the buckets are minimized after erasing.
+ * @param allocator the allocator of the hash map, its buckets and their
+ * vectors (NULL for malloc).
+ * @param old_buckets the buckets which are being migrated, while the hash map
+ * grows incrementally (NULL otherwise).
+ * @param old_capacity the number of old buckets.
+ * @param rehash_index the index of the next old bucket to be migrated.
+ * @param incremental_rehash whether the hash map grows incrementally.
+ * @param value_index reverse index of the pairs by their values (NULL unless
+ * enabled by HashMapSetValueIndex).
+ * @param stats the counters of the hash map (only with HASH_MAP_STATS).
  */
 typedef struct HashMap {
   Vector **buckets;
@@ -87,8 +206,39 @@ typedef struct HashMap {
   HashMapPairCpy pair_cpy;
   HashMapPairCmp pair_cmp;
   HashMapPairFree pair_free;
+  HashMapShrinkPolicy shrink_policy;
+  const Allocator *allocator;
+  Vector **old_buckets;
+  size_t old_capacity;
+  size_t rehash_index;
+  int incremental_rehash;
+  ValueIndex *value_index;
+#ifdef HASH_MAP_STATS
+  HashMapStats stats;
+#endif
 } HashMap;
 
+/**
+ * @struct HashMapIter
+ * A cursor over the pairs of a hash map (see HashMapIterBegin).
+ * @param hash_map the iterated hash map.
+ * @param bucket the index of the current bucket (the new buckets first, then
+ * the old buckets while the hash map is migrating).
+ * @param index the index of the next pair in the current bucket.
+ */
+typedef struct HashMapIter {
+  HashMap *hash_map;
+  size_t bucket;
+  size_t index;
+} HashMapIter;
+
+/**
+ * @typedef HashMapVisit
+ * A function which receives a pair stored in the hash map (the pair itself,
+ * not a copy of it) and a context, and returns 1 to continue, 0 to stop.
+ */
+typedef int (*HashMapVisit)(Pair *, void *);
+
 /**
  * Allocates dynamically new hash map element.
  * @param hash_func a function which "hashes" keys.
@@ -102,6 +252,23 @@ HashMap *HashMapAlloc(
     HashFunc hash_func, HashMapPairCpy pair_cpy,
     HashMapPairCmp pair_cmp, HashMapPairFree pair_free);
 
+/**
+ * Allocates dynamically new hash map element, using the given allocator for
+ * the hash map, its buckets and their vectors (the pairs are still copied by
+ * pair_cpy, set the allocator of their PairType to pool them too).
+ * @param hash_func a function which "hashes" keys.
+ * @param pair_cpy a function which copies pairs.
+ * @param pair_cmp a function which compares pairs.
+ * @param pair_free a function which frees pairs.
+ * @param allocator the allocator to use (NULL for malloc).
+ * @return pointer to dynamically allocated HashMap.
+ * @if_fail return NULL.
+ */
+HashMap *HashMapAllocWith(
+    HashFunc hash_func, HashMapPairCpy pair_cpy,
+    HashMapPairCmp pair_cmp, HashMapPairFree pair_free,
+    const Allocator *allocator);
+
 /**
  * Frees a vector and the elements the vector itself allocated.
  * @param p_hash_map pointer to dynamically allocated pointer to hash_map.
@@ -118,6 +285,59 @@ void HashMapFree(HashMap **p_hash_map);
  */
 int HashMapInsert(HashMap *hash_map, Pair *pair);
 
+/**
+ * Inserts the given pair itself (NOT a copy of it) to the hash map, which
+ * takes ownership of it: it would be freed with pair_free, so the pair must
+ * be allocated the way pair_free expects (e.g. PairAlloc for PairFree).
+ * An existing pair with the same key is freed and replaced.
+ * @param hash_map the hash map to be inserted with new element.
+ * @param pair dynamically allocated pair to be moved into the hash map.
+ * @return returns 1 for successful insertion, 0 otherwise (the pair is then
+ * still owned by the caller).
+ */
+int HashMapInsertOwned(HashMap *hash_map, Pair *pair);
+
+/**
+ * Constructs a new pair of the given type (copying the key and the value
+ * once) directly in the hash map, instead of building a pair and inserting
+ * a copy of it. The pairs of the hash map must be freeable by PairFree.
+ * @param hash_map the hash map to be inserted with new element.
+ * @param key, value the key and value of the new pair.
+ * @param type the type of the new pair.
+ * @return returns 1 for successful insertion, 0 otherwise.
+ */
+int HashMapEmplace(HashMap *hash_map, KeyT key, ValueT value, const PairType *type);
+
+/**
+ * Replaces the value associated with key by a copy of the given value,
+ * keeping the pair and its key as they are.
+ * @param hash_map a hash map.
+ * @param key the key whose value is replaced.
+ * @param value the new value.
+ * @return 1 if the value was replaced, 0 otherwise (e.g. no such key).
+ */
+int HashMapUpdateValue(HashMap *hash_map, KeyT key, ValueT value);
+
+/**
+ * This function makes room for at least n pairs in the hash map, so inserting
+ * up to n pairs does not increase (rehash) the buckets again.
+ * @param hash_map a hash map.
+ * @param n the number of pairs the hash map should hold.
+ * @return 1 for success, 0 otherwise.
+ */
+int HashMapReserve(HashMap *hash_map, size_t n);
+
+/**
+ * Inserts n pairs to the hash map (copies of them, like HashMapInsert).
+ * The buckets are sized once for all the pairs and all the keys are hashed
+ * before inserting, so there are no intermediate rehashes.
+ * @param hash_map the hash map to be inserted with new elements.
+ * @param pairs array of n pairs the hash map would contain.
+ * @param n the number of pairs.
+ * @return returns 1 if all the pairs were inserted, 0 otherwise.
+ */
+int HashMapInsertBulk(HashMap *hash_map, Pair **pairs, size_t n);
+
 /**
  * The function checks if the given key exists in the hash map.
  * @param hash_map a hash map.
@@ -142,6 +362,29 @@ int HashMapContainsValue(HashMap *hash_map, ValueT value);
  */
 ValueT HashMapAt(HashMap *hash_map, KeyT key);
 
+/**
+ * The function looks up many keys at once. It is equal to calling HashMapAt
+ * for every key, but the keys are hashed first and the memory of their
+ * buckets and pairs is prefetched in stages, HASH_MAP_BATCH_SIZE keys at a
+ * time, so the cache misses of different keys overlap.
+ * @param hash_map a hash map.
+ * @param keys the keys to be checked.
+ * @param n the number of keys.
+ * @param out array of n values, out[i] is set to the value associated with
+ * keys[i] if exists, NULL otherwise.
+ * @return the number of keys found.
+ */
+size_t HashMapAtBatch(HashMap *hash_map, KeyT *keys, size_t n, ValueT *out);
+
+/**
+ * The function returns the pair associated with the given key.
+ * @param hash_map a hash map.
+ * @param key the key to be checked.
+ * @return the pair (stored in the hash map, not a copy of it) associated with
+ * key if exists, NULL otherwise.
+ */
+Pair *HashMapGetPair(HashMap *hash_map, KeyT key);
+
 /**
  * The function erases the pair associated with key.
  * @param hash_map a hash map.
@@ -150,6 +393,39 @@ ValueT HashMapAt(HashMap *hash_map, KeyT key);
  */
 int HashMapErase(HashMap *hash_map, KeyT key);
 
+/**
+ * The function removes the pair associated with key from the hash map
+ * *without* freeing it, and returns it (one lookup, like HashMapErase).
+ * @param hash_map a hash map.
+ * @param key a key of the pair to be removed.
+ * @return the removed pair (the caller owns it and frees it, with the
+ * pair_free of the hash map), NULL if there is no such key.
+ */
+Pair *HashMapEraseAndGet(HashMap *hash_map, KeyT key);
+
+/**
+ * The function returns the value associated with the key of the given pair,
+ * and inserts a copy of the pair first if the key is not in the hash map.
+ * The key is hashed and looked up once.
+ * @param hash_map a hash map.
+ * @param pair the pair to be inserted if its key is missing.
+ * @return the value (stored in the hash map) associated with the key,
+ * NULL for failure.
+ */
+ValueT HashMapFindOrInsert(HashMap *hash_map, Pair *pair);
+
+/**
+ * The function inserts a copy of the pair if its key is not in the hash map,
+ * otherwise it merges the value of the pair into the existing value.
+ * The key is hashed and looked up once.
+ * @param hash_map a hash map.
+ * @param pair the pair to be inserted or merged.
+ * @param merge a function which merges the new value into the existing one.
+ * @param ctx a context passed to merge.
+ * @return 1 for success, 0 otherwise.
+ */
+int HashMapUpsert(HashMap *hash_map, Pair *pair, HashMapMerge merge, void *ctx);
+
 /**
  * This function returns the load factor of the hash map.
  * @param hash_map a hash map.
@@ -159,8 +435,129 @@ double HashMapGetLoadFactor(HashMap *hash_map);
 
 /**
  * This function deletes all the elements in the hash map.
+ * All the pairs are freed in one pass and the buckets are reset to
+ * HASH_MAP_INITIAL_CAP once (kept as is if the shrink policy is
+ * HASH_MAP_SHRINK_NEVER).
  * @param hash_map a hash map to be cleared.
  */
 void HashMapClear(HashMap *hash_map);
 
+/**
+ * This function sets when the hash map minimizes its buckets after erasing.
+ * @param hash_map a hash map.
+ * @param policy the shrink policy.
+ */
+void HashMapSetShrinkPolicy(HashMap *hash_map, HashMapShrinkPolicy policy);
+
+/**
+ * This function minimizes the buckets of the hash map (in a single rehash)
+ * to the smallest capacity which holds its elements under
+ * HASH_MAP_MAX_LOAD_FACTOR, but not below HASH_MAP_INITIAL_CAP.
+ * @param hash_map a hash map.
+ * @return 1 for success, 0 otherwise.
+ */
+int HashMapShrinkToFit(HashMap *hash_map);
+
+/**
+ * This function sets whether the hash map grows incrementally.
+ * When enabled, growing the buckets only allocates the new buckets, and every
+ * insert or erase afterwards moves HASH_MAP_REHASH_STEP buckets from the old
+ * buckets to the new ones (lookups check both meanwhile), so no single insert
+ * rehashes the whole hash map. Disabling it finishes an ongoing migration
+ * first; if that fails, the hash map stays incremental (and 0 is returned).
+ * @param hash_map a hash map.
+ * @param enabled 1 to enable, 0 to disable.
+ * @return 1 for success, 0 otherwise.
+ */
+int HashMapSetIncrementalRehash(HashMap *hash_map, int enabled);
+
+/**
+ * This function sets the iterator to the first pair of the hash map.
+ * The order of the pairs is unspecified. The iterator stays valid as long as
+ * the hash map is not modified (lookups never move pairs, also while the hash
+ * map grows incrementally).
+ * @param hash_map a hash map.
+ * @param iter the iterator to be set.
+ * @return 1 for success, 0 otherwise.
+ */
+int HashMapIterBegin(HashMap *hash_map, HashMapIter *iter);
+
+/**
+ * This function returns the next pair of the iteration.
+ * @param iter an iterator set by HashMapIterBegin.
+ * @return the next pair (the pair itself, not a copy of it), NULL if all the
+ * pairs were visited.
+ */
+Pair *HashMapIterNext(HashMapIter *iter);
+
+/**
+ * This function calls visit on every pair of the hash map, bucket by bucket.
+ * The hash map must not be modified during the call (the pairs may be).
+ * @param hash_map a hash map.
+ * @param visit a function which is called with every pair and ctx, returns 0
+ * to stop.
+ * @param ctx a context passed to visit.
+ * @return 1 if all the pairs were visited, 0 otherwise.
+ */
+int HashMapForEach(HashMap *hash_map, HashMapVisit visit, void *ctx);
+
+/**
+ * This function enables (or disables) the reverse value index of the hash map.
+ * While enabled, every pair is indexed by its value as well (one pointer per
+ * pair and a bucket array), so HashMapContainsValue, HashMapKeyOf and
+ * HashMapCountValue do not scan the hash map.
+ * Values changed through the hash map (HashMapUpdateValue, HashMapUpsert) are
+ * re-indexed; a value must not be changed directly (e.g. through HashMapAt)
+ * while the index is enabled. If the index fails to allocate, it is dropped
+ * and the functions scan again.
+ * @param hash_map a hash map.
+ * @param value_hash a function which "hashes" values, NULL to disable.
+ * @return 1 for success, 0 otherwise.
+ */
+int HashMapSetValueIndex(HashMap *hash_map, HashFunc value_hash);
+
+/**
+ * The function returns a key associated with the given value (reverse lookup).
+ * @param hash_map a hash map.
+ * @param value the value to look for.
+ * @return the key (stored in the hash map) of a pair with this value, NULL if
+ * there is none.
+ */
+KeyT HashMapKeyOf(HashMap *hash_map, ValueT value);
+
+/**
+ * The function counts the pairs associated with the given value.
+ * @param hash_map a hash map.
+ * @param value the value to look for.
+ * @return the number of pairs with this value.
+ */
+size_t HashMapCountValue(HashMap *hash_map, ValueT value);
+
+/**
+ * This function fills stats with the counters of the hash map (zero unless
+ * the library is built with HASH_MAP_STATS) and with the current shape of
+ * its buckets (always).
+ * @param hash_map a hash map.
+ * @param stats the stats to be filled.
+ * @return 1 for success, 0 otherwise.
+ */
+int HashMapGetStats(HashMap *hash_map, HashMapStats *stats);
+
+/**
+ * This function resets the counters of the hash map (see HashMapGetStats).
+ * @param hash_map a hash map.
+ */
+void HashMapResetStats(HashMap *hash_map);
+
+/**
+ * This function fills a histogram of the bucket lengths of the hash map:
+ * histogram[i] is the number of buckets with i pairs, and the last bin
+ * counts all the buckets with bins-1 pairs or more.
+ * @param hash_map a hash map.
+ * @param histogram array of bins counters to be filled.
+ * @param bins the number of bins (at least 1).
+ * @return 1 for success, 0 otherwise.
+ */
+int HashMapGetBucketHistogram(HashMap *hash_map, size_t *histogram, size_t bins);
+
 #endif //HASHMAP_H_
@@ -0,0 +1,233 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "HashMapFile.h"
+#include "Hash.h"
+
+/*
+ * "HMAP" read as a native uint32, so a file of another byte order does not
+ * match it.
+ */
+#define HASH_MAP_FILE_MAGIC 0x484D4150U
+#define ALIGN8(n) (((n) + 7) & ~(size_t) 7)
+#define VALUE_OFFSET(key_size) (sizeof(uint64_t) + ALIGN8(key_size))
+#define ENTRY_SIZE(key_size, value_size) (VALUE_OFFSET(key_size) + ALIGN8(value_size))
+
+/*
+ * The header of a hash map file, followed by capacity + 1 uint64 offsets and
+ * size entries of entry_size bytes: uint64 hash, key and value (each padded
+ * to 8 bytes, so the values in the mapping are aligned).
+ */
+typedef struct HashMapFileHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t hash_seed;
+  uint64_t key_size;
+  uint64_t value_size;
+  uint64_t entry_size;
+  uint64_t size;
+  uint64_t capacity;
+} HashMapFileHeader;
+
+int WriteHashMap(HashMap *hash_map, FILE *file, size_t key_size, size_t value_size);
+int ValidHeader(const HashMapFileHeader *header, size_t length);
+
+/**
+ * The function saves the hash map to a file, for HashMapLoadMapped.
+ * The keys and values must have a fixed size and no pointers (e.g. chars and
+ * ints, like PairCharInt.h), their bytes are copied as is. The file has a
+ * header (format version, HASH_SEED, sizes), the bucket offsets and the
+ * entries (the cached hash, the key and the value of every pair) grouped by
+ * bucket. It is for machines with the same byte order and word size.
+ * @param hash_map a hash map.
+ * @param path the path of the file. It is written to path + ".tmp", synced and
+ * renamed over path, so an existing file is replaced only by a complete one.
+ * @param key_size the size (in bytes) of every key.
+ * @param value_size the size (in bytes) of every value.
+ * @return 1 for success, 0 otherwise (then an existing file is kept as is).
+ */
+int HashMapSave(HashMap *hash_map, const char *path, size_t key_size, size_t value_size){
+    if (!hash_map || !path || key_size == 0 || value_size == 0) return 0;
+    char *tmp_path = malloc(strlen(path) + sizeof(".tmp"));
+    if (!tmp_path) return 0;
+    strcpy(tmp_path, path);
+    strcat(tmp_path, ".tmp");
+    FILE *file = fopen(tmp_path, "wb");
+    if (!file){
+        free(tmp_path);
+        return 0;
+    }
+    int written = WriteHashMap(hash_map, file, key_size, value_size);
+    if (written && (fflush(file) != 0 || fsync(fileno(file)) != 0)) written = 0;
+    if (fclose(file) != 0) written = 0;
+    if (written && rename(tmp_path, path) != 0) written = 0;
+    if (!written) remove(tmp_path);
+    free(tmp_path);
+    return written;
+}
+
+/**
+ * The function maps a file saved by HashMapSave, for read-only lookups.
+ * @param path the path of the file.
+ * @param hash_func the hash func of the saved hash map.
+ * @return pointer to dynamically allocated HashMapMapped.
+ * @if_fail return NULL (also if the file is not a valid hash map file).
+ */
+HashMapMapped *HashMapLoadMapped(const char *path, HashFunc hash_func){
+    if (!path || !hash_func) return NULL;
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) return NULL;
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == -1 || (size_t) file_stat.st_size < sizeof(HashMapFileHeader)){
+        close(fd);
+        return NULL;
+    }
+    size_t length = (size_t) file_stat.st_size;
+    void *base = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping keeps the file.
+    if (base == MAP_FAILED) return NULL;
+    const HashMapFileHeader *header = (const HashMapFileHeader *) base;
+    HashMapMapped *mapped = malloc(sizeof(HashMapMapped));
+    if (!mapped || !ValidHeader(header, length)){
+        free(mapped);
+        munmap(base, length);
+        return NULL;
+    }
+    mapped->base = base;
+    mapped->length = length;
+    mapped->size = header->size;
+    mapped->capacity = header->capacity;
+    mapped->key_size = header->key_size;
+    mapped->value_size = header->value_size;
+    mapped->entry_size = header->entry_size;
+    mapped->offsets = (const uint64_t *) (header + 1);
+    mapped->entries = (const char *) (mapped->offsets + mapped->capacity + 1);
+    mapped->hash_func = hash_func;
+    return mapped;
+}
+
+/**
+ * Unmaps the file and frees the mapped hash map.
+ * @param p_mapped pointer to dynamically allocated pointer to mapped hash map.
+ */
+void HashMapMappedFree(HashMapMapped **p_mapped){
+    if (!p_mapped || !(*p_mapped)) return;
+    munmap((*p_mapped)->base, (*p_mapped)->length);
+    free(*p_mapped);
+    *p_mapped = NULL;
+}
+
+/**
+ * The function returns the value associated with the given key.
+ * @param mapped a mapped hash map.
+ * @param key pointer to the key (key_size bytes).
+ * @return pointer to the value (value_size bytes, inside the mapping, valid
+ * until HashMapMappedFree), NULL if there is no such key.
+ */
+const void *HashMapMappedAt(HashMapMapped *mapped, KeyT key){
+    if (!mapped || !key) return NULL;
+    uint64_t hash = HashFinalize(mapped->hash_func(key));
+    size_t bucket = (size_t) hash & (mapped->capacity - 1);
+    const char *entry = mapped->entries + mapped->offsets[bucket] * mapped->entry_size;
+    const char *end = mapped->entries + mapped->offsets[bucket + 1] * mapped->entry_size;
+    for (; entry < end; entry += mapped->entry_size) {
+        uint64_t entry_hash;
+        memcpy(&entry_hash, entry, sizeof(entry_hash));
+        if (entry_hash == hash &&
+            memcmp(entry + sizeof(uint64_t), key, mapped->key_size) == 0){
+            return entry + VALUE_OFFSET(mapped->key_size);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * The function checks if the given key exists in the mapped hash map.
+ * @param mapped a mapped hash map.
+ * @param key pointer to the key (key_size bytes).
+ * @return 1 if the key is in the map, 0 otherwise.
+ */
+int HashMapMappedContainsKey(HashMapMapped *mapped, KeyT key){
+    return HashMapMappedAt(mapped, key) != NULL;
+}
+
+/*
+ * This function writes the header, the offsets and the entries of the hash
+ * map. The buckets of the file are chosen by the cached hashes of the pairs,
+ * so no key is hashed again. Returns 1 for success, 0 for failure.
+ */
+int WriteHashMap(HashMap *hash_map, FILE *file, size_t key_size, size_t value_size){
+    HashMapFileHeader header = {HASH_MAP_FILE_MAGIC, HASH_MAP_FILE_VERSION, HASH_SEED,
+                                key_size, value_size,
+                                ENTRY_SIZE(key_size, value_size),
+                                hash_map->size, 1};
+    while (header.capacity < hash_map->size) header.capacity <<= 1;
+    uint64_t *offsets = calloc(header.capacity + 1, sizeof(uint64_t));
+    Pair **sorted = malloc((hash_map->size > 0 ? hash_map->size : 1) * sizeof(Pair *));
+    char *entry = calloc(1, header.entry_size);
+    int written = offsets && sorted && entry;
+    if (written){
+        // counting sort of the pairs by their bucket in the file.
+        HashMapIter iter;
+        HashMapIterBegin(hash_map, &iter);
+        for (Pair *pair = HashMapIterNext(&iter); pair; pair = HashMapIterNext(&iter)) {
+            offsets[(pair->hash & (header.capacity - 1)) + 1]++;
+        }
+        for (size_t i = 0; i < header.capacity; ++i) offsets[i + 1] += offsets[i];
+        HashMapIterBegin(hash_map, &iter);
+        for (Pair *pair = HashMapIterNext(&iter); pair; pair = HashMapIterNext(&iter)) {
+            sorted[offsets[pair->hash & (header.capacity - 1)]++] = pair;
+        }
+        // placing moved every offset to the end of its bucket, move them back.
+        for (size_t i = header.capacity; i > 0; --i) offsets[i] = offsets[i - 1];
+        offsets[0] = 0;
+        written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                  fwrite(offsets, sizeof(uint64_t), header.capacity + 1, file) ==
+                  header.capacity + 1;
+    }
+    for (size_t i = 0; written && i < hash_map->size; ++i) {
+        uint64_t hash = sorted[i]->hash;
+        memcpy(entry, &hash, sizeof(hash));
+        memcpy(entry + sizeof(uint64_t), sorted[i]->key, key_size);
+        memcpy(entry + VALUE_OFFSET(key_size), sorted[i]->value, value_size);
+        written = fwrite(entry, header.entry_size, 1, file) == 1;
+    }
+    free(offsets);
+    free(sorted);
+    free(entry);
+    return written;
+}
+
+/*
+ * This function checks that the header belongs to a hash map file of this
+ * format and build, and that the offsets and entries fit in the file.
+ */
+int ValidHeader(const HashMapFileHeader *header, size_t length){
+    if (header->magic != HASH_MAP_FILE_MAGIC || header->version != HASH_MAP_FILE_VERSION ||
+        header->hash_seed != HASH_SEED){
+        return 0;
+    }
+    if (header->key_size == 0 || header->value_size == 0 ||
+        header->key_size > length || header->value_size > length ||
+        header->capacity > length / sizeof(uint64_t)){
+        return 0;
+    }
+    if (header->capacity == 0 || (header->capacity & (header->capacity - 1)) != 0 ||
+        header->entry_size != ENTRY_SIZE(header->key_size, header->value_size)){
+        return 0;
+    }
+    size_t offsets_length = (header->capacity + 1) * sizeof(uint64_t);
+    if (length < sizeof(HashMapFileHeader) + offsets_length) return 0;
+    const uint64_t *offsets = (const uint64_t *) (header + 1);
+    size_t entries_length = length - sizeof(HashMapFileHeader) - offsets_length;
+    if (header->size > entries_length / header->entry_size) return 0;
+    if (offsets[0] != 0 || offsets[header->capacity] != header->size) return 0;
+    for (size_t i = 0; i < header->capacity; ++i) {
+        if (offsets[i] > offsets[i + 1]) return 0;
+    }
+    return 1;
+}
@@ -0,0 +1,93 @@
+#ifndef HASHMAPFILE_H_
+#define HASHMAPFILE_H_
+
+#include <stdlib.h>
+#include <stdint.h>
+#include "HashMap.h"
+
+/**
+ * @def HASH_MAP_FILE_VERSION
+ * The version of the hash map file format (see HashMapSave).
+ */
+#define HASH_MAP_FILE_VERSION 1U
+
+/**
+ * @struct HashMapMapped
+ * A read-only hash map served directly from a file saved by HashMapSave,
+ * which is memory mapped (so loading it does not read or allocate the
+ * entries, the pages are read on first use).
+ * @param base the mapping of the file.
+ * @param length the length of the mapping.
+ * @param size the number of pairs.
+ * @param capacity the number of buckets (power of 2).
+ * @param key_size, value_size the size (in bytes) of every key and value.
+ * @param entry_size the size (in bytes) of every entry.
+ * @param offsets capacity + 1 offsets: the entries of bucket i are
+ * [offsets[i], offsets[i + 1]).
+ * @param entries the entries (hash, key, value, each aligned to 8 bytes),
+ * grouped by bucket.
+ * @param hash_func the function which "hashes" keys (the one of the saved
+ * hash map).
+ */
+typedef struct HashMapMapped {
+  void *base;
+  size_t length;
+  size_t size;
+  size_t capacity;
+  size_t key_size;
+  size_t value_size;
+  size_t entry_size;
+  const uint64_t *offsets;
+  const char *entries;
+  HashFunc hash_func;
+} HashMapMapped;
+
+/**
+ * The function saves the hash map to a file, for HashMapLoadMapped.
+ * The keys and values must have a fixed size and no pointers (e.g. chars and
+ * ints, like PairCharInt.h), their bytes are copied as is. The file has a
+ * header (format version, HASH_SEED, sizes), the bucket offsets and the
+ * entries (the cached hash, the key and the value of every pair) grouped by
+ * bucket. It is for machines with the same byte order and word size.
+ * @param hash_map a hash map.
+ * @param path the path of the file. It is written to path + ".tmp", synced and
+ * renamed over path, so an existing file is replaced only by a complete one.
+ * @param key_size the size (in bytes) of every key.
+ * @param value_size the size (in bytes) of every value.
+ * @return 1 for success, 0 otherwise (then an existing file is kept as is).
+ */
+int HashMapSave(HashMap *hash_map, const char *path, size_t key_size, size_t value_size);
+
+/**
+ * The function maps a file saved by HashMapSave, for read-only lookups.
+ * @param path the path of the file.
+ * @param hash_func the hash func of the saved hash map.
+ * @return pointer to dynamically allocated HashMapMapped.
+ * @if_fail return NULL (also if the file is not a valid hash map file).
+ */
+HashMapMapped *HashMapLoadMapped(const char *path, HashFunc hash_func);
+
+/**
+ * Unmaps the file and frees the mapped hash map.
+ * @param p_mapped pointer to dynamically allocated pointer to mapped hash map.
+ */
+void HashMapMappedFree(HashMapMapped **p_mapped);
+
+/**
+ * The function returns the value associated with the given key.
+ * @param mapped a mapped hash map.
+ * @param key pointer to the key (key_size bytes).
+ * @return pointer to the value (value_size bytes, inside the mapping, valid
+ * until HashMapMappedFree), NULL if there is no such key.
+ */
+const void *HashMapMappedAt(HashMapMapped *mapped, KeyT key);
+
+/**
+ * The function checks if the given key exists in the mapped hash map.
+ * @param mapped a mapped hash map.
+ * @param key pointer to the key (key_size bytes).
+ * @return 1 if the key is in the map, 0 otherwise.
+ */
+int HashMapMappedContainsKey(HashMapMapped *mapped, KeyT key);
+
+#endif //HASHMAPFILE_H_
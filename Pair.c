@@ -1,27 +1,30 @@
+#include <string.h>
 #include "Pair.h"
 
 /**
  * Allocates dynamically a new pair.
+ * The key and value are copied with PairCopyKey and PairCopyValue, and the
+ * pair struct is allocated with the allocator of the type.
  * @param key, value - the key and value.
- * @param key_cpy, value_cpy - copy functions for key and value.
- * @param key_cmp, value_cmp - compare functions for key and value.
- * @param key_free, value_free - free functions for key and value.
- * @return dynamically allocated pair.
+ * @param type - the type of the pair.
+ * @return dynamically allocated pair, NULL for failure.
  */
-Pair *PairAlloc(
-    KeyT key, ValueT value,
-    PairKeyCpy key_cpy, PairValueCpy value_cpy,
-    PairKeyCmp key_cmp, PairValueCmp value_cmp,
-    PairKeyFree key_free, PairValueFree value_free) {
-  Pair *pair = malloc(sizeof(Pair));
-  pair->key = key_cpy(key);
-  pair->value = value_cpy(value);
-  pair->key_cpy = key_cpy;
-  pair->value_cpy = value_cpy;
-  pair->key_cmp = key_cmp;
-  pair->value_cmp = value_cmp;
-  pair->key_free = key_free;
-  pair->value_free = value_free;
+Pair *PairAlloc(KeyT key, ValueT value, const PairType *type) {
+  if (!type) {
+    return NULL;
+  }
+  Pair *pair = AllocatorAlloc(type->allocator, sizeof(Pair));
+  if (!pair) {
+    return NULL;
+  }
+  pair->key = PairCopyKey(type, key);
+  pair->value = PairCopyValue(type, value);
+  pair->type = type;
+  pair->hash = 0;
+  // a NULL copy of a non NULL key (value) means the allocation failed.
+  if ((key && !pair->key) || (value && !pair->value)) {
+    PairFree(&pair);
+  }
   return pair;
 }
 
@@ -34,10 +37,10 @@ Pair *PairCopy(const Pair *pair) {
   if (!pair) {
     return NULL;
   }
-  Pair *new_pair = PairAlloc(pair->key, pair->value,
-      pair->key_cpy, pair->value_cpy,
-      pair->key_cmp, pair->value_cmp,
-      pair->key_free, pair->value_free);
+  Pair *new_pair = PairAlloc(pair->key, pair->value, pair->type);
+  if (new_pair) {
+    new_pair->hash = pair->hash;
+  }
   return new_pair;
 }
 
@@ -47,9 +50,77 @@ Pair *PairCopy(const Pair *pair) {
  */
 void PairFree(Pair **p_pair) {
   if (p_pair && (*p_pair)) {
-    (*p_pair)->key_free(&(*p_pair)->key);
-    (*p_pair)->value_free(&(*p_pair)->value);
-    free((*p_pair));
+    const PairType *type = (*p_pair)->type;
+    PairFreeKey(type, &(*p_pair)->key);
+    PairFreeValue(type, &(*p_pair)->value);
+    AllocatorFree(type->allocator, *p_pair, sizeof(Pair));
     *p_pair = NULL;
   }
 }
+
+/**
+ * Copies a key of the given type: flat keys (key_size) into a block of the
+ * allocator of the type, other keys with key_cpy.
+ * @param type the type of the pair.
+ * @param key the key to be copied.
+ * @return the copy, NULL for failure.
+ */
+KeyT PairCopyKey(const PairType *type, KeyT key) {
+  if (!type->key_size) {
+    return type->key_cpy(key);
+  }
+  KeyT copy = AllocatorAlloc(type->allocator, type->key_size);
+  if (copy) {
+    memcpy(copy, key, type->key_size);
+  }
+  return copy;
+}
+
+/**
+ * Copies a value of the given type (like PairCopyKey).
+ * @param type the type of the pair.
+ * @param value the value to be copied.
+ * @return the copy, NULL for failure.
+ */
+ValueT PairCopyValue(const PairType *type, ValueT value) {
+  if (!type->value_size) {
+    return type->value_cpy(value);
+  }
+  ValueT copy = AllocatorAlloc(type->allocator, type->value_size);
+  if (copy) {
+    memcpy(copy, value, type->value_size);
+  }
+  return copy;
+}
+
+/**
+ * Frees a key copied by PairCopyKey.
+ * @param type the type of the pair.
+ * @param p_key pointer to the key, set to NULL.
+ */
+void PairFreeKey(const PairType *type, KeyT *p_key) {
+  if (!type->key_size) {
+    type->key_free(p_key);
+    return;
+  }
+  if (p_key && *p_key) {
+    AllocatorFree(type->allocator, *p_key, type->key_size);
+    *p_key = NULL;
+  }
+}
+
+/**
+ * Frees a value copied by PairCopyValue.
+ * @param type the type of the pair.
+ * @param p_value pointer to the value, set to NULL.
+ */
+void PairFreeValue(const PairType *type, ValueT *p_value) {
+  if (!type->value_size) {
+    type->value_free(p_value);
+    return;
+  }
+  if (p_value && *p_value) {
+    AllocatorFree(type->allocator, *p_value, type->value_size);
+    *p_value = NULL;
+  }
+}
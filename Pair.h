@@ -2,6 +2,7 @@
 #define PAIR_H_
 
 #include <stdlib.h>
+#include "Allocator.h"
 
 /**
  * @typedef KeyT, ValueT
@@ -32,36 +33,56 @@ typedef void (*PairKeyFree)(KeyT *);
 typedef void (*PairValueFree)(ValueT *);
 
 /**
- * @struct Pair - represent a pair '''{key: value}'''.
- * @param key, value - the key and value.
+ * @struct PairType - the functions of a kind of pairs (e.g. {char: int}).
+ * A pair type is shared by all the pairs of that kind (usually defined once,
+ * statically, next to its functions), so the pairs themselves only store
+ * the key, the value, a pointer to their type and the cached hash of the key
+ * (32 bytes on 64-bit).
  * @param key_cpy, value_cpy - copy functions for key and value.
  * @param key_cmp, value_cmp - compare functions for key and value.
  * @param key_free, value_free - free functions for key and value.
+ * @param allocator - the allocator of the pair structs (NULL for malloc).
+ * @param key_size, value_size - the size of flat (memcpy-able) keys and values,
+ * 0 otherwise. A flat key (value) is copied into a block of the allocator and
+ * released to it, instead of key_cpy and key_free (value_cpy, value_free), so
+ * a pool allocator holds the whole pair.
  */
-typedef struct Pair {
-  KeyT key;
-  ValueT value;
+typedef struct PairType {
   PairKeyCpy key_cpy;
   PairValueCpy value_cpy;
   PairKeyCmp key_cmp;
   PairValueCmp value_cmp;
   PairKeyFree key_free;
   PairValueFree value_free;
+  const Allocator *allocator;
+  size_t key_size;
+  size_t value_size;
+} PairType;
+
+/**
+ * @struct Pair - represent a pair '''{key: value}'''.
+ * @param key, value - the key and value.
+ * @param type - the (shared) type of the pair, must outlive the pair.
+ * @param hash - the hash of the key, cached by the hash map which stores
+ * the pair (so lookups compare hashes before keys, and rehashing does not
+ * call the hash func again).
+ */
+typedef struct Pair {
+  KeyT key;
+  ValueT value;
+  const PairType *type;
+  size_t hash;
 } Pair;
 
 /**
  * Allocates dynamically a new pair.
+ * The key and value are copied with PairCopyKey and PairCopyValue, and the
+ * pair struct is allocated with the allocator of the type.
  * @param key, value - the key and value.
- * @param key_cpy, value_cpy - copy functions for key and value.
- * @param key_cmp, value_cmp - compare functions for key and value.
- * @param key_free, value_free - free functions for key and value.
- * @return dynamically allocated pair.
+ * @param type - the type of the pair.
+ * @return dynamically allocated pair, NULL for failure.
  */
-Pair *PairAlloc(
-    KeyT key, ValueT value,
-    PairKeyCpy key_cpy, PairValueCpy value_cpy,
-    PairKeyCmp key_cmp, PairValueCmp value_cmp,
-    PairKeyFree key_free, PairValueFree value_free);
+Pair *PairAlloc(KeyT key, ValueT value, const PairType *type);
 
 /**
  * Creates a new (dynamically allocated) copy of the given pair.
@@ -76,4 +97,35 @@ Pair *PairCopy(const Pair *pair);
  */
 void PairFree(Pair **p_pair);
 
+/**
+ * Copies a key of the given type: flat keys (key_size) into a block of the
+ * allocator of the type, other keys with key_cpy.
+ * @param type the type of the pair.
+ * @param key the key to be copied.
+ * @return the copy, NULL for failure.
+ */
+KeyT PairCopyKey(const PairType *type, KeyT key);
+
+/**
+ * Copies a value of the given type (like PairCopyKey).
+ * @param type the type of the pair.
+ * @param value the value to be copied.
+ * @return the copy, NULL for failure.
+ */
+ValueT PairCopyValue(const PairType *type, ValueT value);
+
+/**
+ * Frees a key copied by PairCopyKey.
+ * @param type the type of the pair.
+ * @param p_key pointer to the key, set to NULL.
+ */
+void PairFreeKey(const PairType *type, KeyT *p_key);
+
+/**
+ * Frees a value copied by PairCopyValue.
+ * @param type the type of the pair.
+ * @param p_value pointer to the value, set to NULL.
+ */
+void PairFreeValue(const PairType *type, ValueT *p_value);
+
 #endif //PAIR_H_
@@ -2,6 +2,8 @@
  * Pairs like { char: int }
  * The key type is char *.
  * The value type is int *.
+ * The key and value are flat (key_size / value_size), so they are allocated
+ * with the allocator of the type, like the pair itself.
  */
 
 #ifndef PAIRCHARINT_H_
@@ -62,6 +64,18 @@ void IntValueFree(void **val) {
   }
 }
 
+/**
+ * The type of the { char: int } pairs (allocated with malloc). For a pooled
+ * type, copy it and set its allocator (e.g. SlabAllocatorGet).
+ */
+const PairType PairCharIntType = {
+  CharKeyCpy, IntValueCpy,
+  CharKeyCmp, IntValueCmp,
+  CharKeyFree, IntValueFree,
+  NULL,
+  sizeof(char), sizeof(int)
+};
+
 /**
  * Copy func for the pair.
  */
@@ -82,8 +96,8 @@ int PairCharIntCmp(const void *p_1, const void *p_2) {
   const Pair *pair_1 = (const Pair *) p_1;
   const Pair *pair_2 = (const Pair *) p_2;
 
-  int key_cmp = pair_1->key_cmp(pair_1->key, pair_2->key);
-  int val_cmp = pair_1->value_cmp(pair_1->value, pair_2->value);
+  int key_cmp = pair_1->type->key_cmp(pair_1->key, pair_2->key);
+  int val_cmp = pair_1->type->value_cmp(pair_1->value, pair_2->value);
   return key_cmp && val_cmp;
 }
 
@@ -95,11 +109,7 @@ void PairCharIntFree(void **p_p) {
     return;
   }
 
-  Pair **p_pair = (Pair **) p_p;
-  (*p_pair)->key_free(&(*p_pair)->key);
-  (*p_pair)->value_free(&(*p_pair)->value);
-  free(*p_pair);
-  *p_pair = NULL;
+  PairFree((Pair **) p_p);
 }
 
 #endif //PAIRCHARINT_H_
@@ -0,0 +1,246 @@
+#include <string.h>
+#include "SimdFind.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && defined(__SSE2__)
+#define SIMD_FIND_X86 1
+#include <immintrin.h>
+#else
+#define SIMD_FIND_X86 0
+#endif
+
+/*
+ * The kernels of one instruction set.
+ */
+typedef struct FindKernels {
+  size_t (*find_u8)(const void *, size_t, uint8_t);
+  size_t (*find_u32)(const void *, size_t, uint32_t);
+  size_t (*find_u64)(const void *, size_t, uint64_t);
+  size_t (*find_double)(const double *, size_t, double);
+} FindKernels;
+
+const FindKernels *GetKernels(void);
+size_t ScalarFindU8(const void *data, size_t n, uint8_t value);
+size_t ScalarFindU32(const void *data, size_t n, uint32_t value);
+size_t ScalarFindU64(const void *data, size_t n, uint64_t value);
+size_t ScalarFindDouble(const double *data, size_t n, double value);
+
+/**
+ * Finds the first byte equal to value in data[0, n).
+ */
+size_t SimdFindU8(const void *data, size_t n, uint8_t value){
+    return GetKernels()->find_u8(data, n, value);
+}
+
+/**
+ * Finds the first 32 bit element equal (bitwise) to value in data[0, n).
+ */
+size_t SimdFindU32(const void *data, size_t n, uint32_t value){
+    return GetKernels()->find_u32(data, n, value);
+}
+
+/**
+ * Finds the first 64 bit element equal (bitwise) to value in data[0, n).
+ */
+size_t SimdFindU64(const void *data, size_t n, uint64_t value){
+    return GetKernels()->find_u64(data, n, value);
+}
+
+/**
+ * Finds the first double equal (==) to value in data[0, n), so 0.0 and -0.0
+ * are equal and NaN is never found.
+ */
+size_t SimdFindDouble(const double *data, size_t n, double value){
+    return GetKernels()->find_double(data, n, value);
+}
+
+/*
+ * The scalar kernels, used off x86 and for the tails of the vector kernels.
+ * The elements are read with memcpy, so data does not have to be aligned.
+ */
+size_t ScalarFindU8(const void *data, size_t n, uint8_t value){
+    const uint8_t *found = memchr(data, value, n);
+    return found ? (size_t) (found - (const uint8_t *) data) : n;
+}
+
+size_t ScalarFindU32(const void *data, size_t n, uint32_t value){
+    const char *elem = (const char *) data;
+    for (size_t i = 0; i < n; ++i, elem += sizeof(uint32_t)) {
+        uint32_t x;
+        memcpy(&x, elem, sizeof(x));
+        if (x == value) return i;
+    }
+    return n;
+}
+
+size_t ScalarFindU64(const void *data, size_t n, uint64_t value){
+    const char *elem = (const char *) data;
+    for (size_t i = 0; i < n; ++i, elem += sizeof(uint64_t)) {
+        uint64_t x;
+        memcpy(&x, elem, sizeof(x));
+        if (x == value) return i;
+    }
+    return n;
+}
+
+size_t ScalarFindDouble(const double *data, size_t n, double value){
+    for (size_t i = 0; i < n; ++i) {
+        if (data[i] == value) return i;
+    }
+    return n;
+}
+
+#if SIMD_FIND_X86
+
+/*
+ * SSE2 kernels: 16 chars, 4 ints or 2 doubles per compare.
+ * A match sets bits in the compare mask, its lowest set bit is the first one.
+ */
+static size_t Sse2FindU8(const void *data, size_t n, uint8_t value){
+    const char *bytes = (const char *) data;
+    __m128i key = _mm_set1_epi8((char) value);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *) (bytes + i));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(x, key));
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    return i + ScalarFindU8(bytes + i, n - i, value);
+}
+
+static size_t Sse2FindU32(const void *data, size_t n, uint32_t value){
+    const char *elems = (const char *) data;
+    __m128i key = _mm_set1_epi32((int) value);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i x = _mm_loadu_si128((const __m128i *) (elems + i * 4));
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(x, key)));
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    return i + ScalarFindU32(elems + i * 4, n - i, value);
+}
+
+static size_t Sse2FindU64(const void *data, size_t n, uint64_t value){
+    const char *elems = (const char *) data;
+    __m128i key = _mm_set1_epi64x((long long) value);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128i x = _mm_loadu_si128((const __m128i *) (elems + i * 8));
+        // SSE2 has no 64 bit compare: both 32 bit halves of an element must match.
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(x, key)));
+        mask &= mask >> 1;
+        if (mask & 1) return i;
+        if (mask & 4) return i + 1;
+    }
+    return i + ScalarFindU64(elems + i * 8, n - i, value);
+}
+
+static size_t Sse2FindDouble(const double *data, size_t n, double value){
+    __m128d key = _mm_set1_pd(value);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        int mask = _mm_movemask_pd(_mm_cmpeq_pd(_mm_loadu_pd(data + i), key));
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    return i + ScalarFindDouble(data + i, n - i, value);
+}
+
+/*
+ * AVX2 kernels: 32 chars, 8 ints or 4 doubles per compare, two registers per
+ * iteration so the loads of the next block overlap the compares.
+ */
+__attribute__((target("avx2")))
+static size_t Avx2FindU8(const void *data, size_t n, uint8_t value){
+    const char *bytes = (const char *) data;
+    __m256i key = _mm256_set1_epi8((char) value);
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        __m256i c0 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (bytes + i)), key);
+        __m256i c1 = _mm256_cmpeq_epi8(
+            _mm256_loadu_si256((const __m256i *) (bytes + i + 32)), key);
+        uint64_t mask = (uint32_t) _mm256_movemask_epi8(c0) |
+                        (uint64_t) (uint32_t) _mm256_movemask_epi8(c1) << 32;
+        if (mask) return i + __builtin_ctzll(mask);
+    }
+    return i + Sse2FindU8(bytes + i, n - i, value);
+}
+
+__attribute__((target("avx2")))
+static size_t Avx2FindU32(const void *data, size_t n, uint32_t value){
+    const char *elems = (const char *) data;
+    __m256i key = _mm256_set1_epi32((int) value);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i c0 = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *) (elems + i * 4)),
+                                        key);
+        __m256i c1 = _mm256_cmpeq_epi32(
+            _mm256_loadu_si256((const __m256i *) (elems + i * 4 + 32)), key);
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(c0)) |
+                   _mm256_movemask_ps(_mm256_castsi256_ps(c1)) << 8;
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    return i + Sse2FindU32(elems + i * 4, n - i, value);
+}
+
+__attribute__((target("avx2")))
+static size_t Avx2FindU64(const void *data, size_t n, uint64_t value){
+    const char *elems = (const char *) data;
+    __m256i key = _mm256_set1_epi64x((long long) value);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i c0 = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i *) (elems + i * 8)),
+                                        key);
+        __m256i c1 = _mm256_cmpeq_epi64(
+            _mm256_loadu_si256((const __m256i *) (elems + i * 8 + 32)), key);
+        int mask = _mm256_movemask_pd(_mm256_castsi256_pd(c0)) |
+                   _mm256_movemask_pd(_mm256_castsi256_pd(c1)) << 4;
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    return i + Sse2FindU64(elems + i * 8, n - i, value);
+}
+
+__attribute__((target("avx2")))
+static size_t Avx2FindDouble(const double *data, size_t n, double value){
+    __m256d key = _mm256_set1_pd(value);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256d c0 = _mm256_cmp_pd(_mm256_loadu_pd(data + i), key, _CMP_EQ_OQ);
+        __m256d c1 = _mm256_cmp_pd(_mm256_loadu_pd(data + i + 4), key, _CMP_EQ_OQ);
+        int mask = _mm256_movemask_pd(c0) | _mm256_movemask_pd(c1) << 4;
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    return i + Sse2FindDouble(data + i, n - i, value);
+}
+
+static const FindKernels SSE2_KERNELS = {Sse2FindU8, Sse2FindU32, Sse2FindU64,
+                                         Sse2FindDouble};
+static const FindKernels AVX2_KERNELS = {Avx2FindU8, Avx2FindU32, Avx2FindU64,
+                                         Avx2FindDouble};
+
+/*
+ * This function returns the kernels of the best instruction set the CPU
+ * supports (checked once; racing threads compute and store the same answer).
+ */
+const FindKernels *GetKernels(void){
+    static const FindKernels *kernels = NULL;
+    const FindKernels *found = __atomic_load_n(&kernels, __ATOMIC_RELAXED);
+    if (!found){
+        __builtin_cpu_init();
+        found = __builtin_cpu_supports("avx2") ? &AVX2_KERNELS : &SSE2_KERNELS;
+        __atomic_store_n(&kernels, found, __ATOMIC_RELAXED);
+    }
+    return found;
+}
+
+#else
+
+static const FindKernels SCALAR_KERNELS = {ScalarFindU8, ScalarFindU32, ScalarFindU64,
+                                           ScalarFindDouble};
+
+/*
+ * This function returns the kernels of the target (scalar without x86 SIMD).
+ */
+const FindKernels *GetKernels(void){
+    return &SCALAR_KERNELS;
+}
+
+#endif
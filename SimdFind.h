@@ -0,0 +1,38 @@
+#ifndef SIMDFIND_H_
+#define SIMDFIND_H_
+
+#include <stdlib.h>
+#include <stdint.h>
+
+/**
+ * Search kernels over dense arrays of primitive elements (e.g. the data of a
+ * FlatVector of chars, ints or doubles).
+ * On x86 the kernels compare a whole SSE2 (16 bytes) or AVX2 (32 bytes)
+ * register of elements per instruction; AVX2 is chosen at runtime, once, if
+ * the CPU supports it. On other targets they are plain loops.
+ * Every kernel returns the index of the first matching element, n if there
+ * is none.
+ */
+
+/**
+ * Finds the first byte equal to value in data[0, n).
+ */
+size_t SimdFindU8(const void *data, size_t n, uint8_t value);
+
+/**
+ * Finds the first 32 bit element equal (bitwise) to value in data[0, n).
+ */
+size_t SimdFindU32(const void *data, size_t n, uint32_t value);
+
+/**
+ * Finds the first 64 bit element equal (bitwise) to value in data[0, n).
+ */
+size_t SimdFindU64(const void *data, size_t n, uint64_t value);
+
+/**
+ * Finds the first double equal (==) to value in data[0, n), so 0.0 and -0.0
+ * are equal and NaN is never found.
+ */
+size_t SimdFindDouble(const double *data, size_t n, double value);
+
+#endif //SIMDFIND_H_
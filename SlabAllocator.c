@@ -0,0 +1,166 @@
+#include <string.h>
+#include "SlabAllocator.h"
+
+/*
+ * Header of every block bigger than the size classes, so SlabAllocatorFree can
+ * release them too. Its size keeps the block itself aligned.
+ */
+typedef struct LargeBlock {
+  struct LargeBlock *prev;
+  struct LargeBlock *next;
+} LargeBlock;
+
+int SizeClass(size_t size);
+void *SlabAlloc(void *ctx, size_t size);
+void *SlabResize(void *ctx, void *ptr, size_t old_size, size_t new_size);
+void SlabRelease(void *ctx, void *ptr, size_t size);
+
+/**
+ * Allocates dynamically a new (empty) slab allocator.
+ * @return pointer to dynamically allocated SlabAllocator.
+ * @if_fail return NULL.
+ */
+SlabAllocator *SlabAllocatorAlloc(void){
+    SlabAllocator *slab = calloc(1, sizeof(SlabAllocator));
+    if (!slab) return NULL;
+    slab->allocator.ctx = slab;
+    slab->allocator.alloc = SlabAlloc;
+    slab->allocator.resize = SlabResize;
+    slab->allocator.release = SlabRelease;
+    return slab;
+}
+
+/**
+ * Frees a slab allocator and *all* the blocks allocated from it, at once.
+ * @param p_slab pointer to dynamically allocated pointer to slab allocator.
+ */
+void SlabAllocatorFree(SlabAllocator **p_slab){
+    if (!p_slab || !(*p_slab)){
+        return;
+    }
+    void *slab = (*p_slab)->slabs;
+    while (slab){
+        void *next = *(void **) slab;
+        free(slab);
+        slab = next;
+    }
+    LargeBlock *block = (*p_slab)->large;
+    while (block){
+        LargeBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    free(*p_slab);
+    *p_slab = NULL;
+}
+
+/**
+ * Returns the Allocator interface of the slab allocator, to be passed to
+ * VectorAllocWith, HashMapAllocWith and as the allocator of a PairType.
+ * @param slab a slab allocator.
+ * @return the allocator interface (valid as long as the slab allocator is).
+ */
+const Allocator *SlabAllocatorGet(SlabAllocator *slab){
+    if (!slab) return NULL;
+    return &slab->allocator;
+}
+
+/*
+ * This function returns the size class of the given size, -1 if the size is
+ * bigger than all the size classes.
+ */
+int SizeClass(size_t size){
+    size_t block = SLAB_ALLOCATOR_MIN_BLOCK;
+    for (int i = 0; i < SLAB_ALLOCATOR_NUM_CLASSES; ++i) {
+        if (size <= block) return i;
+        block <<= 1;
+    }
+    return -1;
+}
+
+/*
+ * This function allocates a block from the free list of its size class, or
+ * carves it from the current slab. Bigger blocks are malloc'd and linked.
+ */
+void *SlabAlloc(void *ctx, size_t size){
+    SlabAllocator *slab = (SlabAllocator *) ctx;
+    int size_class = SizeClass(size);
+    if (size_class == -1){
+        LargeBlock *block = malloc(sizeof(LargeBlock) + size);
+        if (!block) return NULL;
+        block->prev = NULL;
+        block->next = slab->large;
+        if (block->next) block->next->prev = block;
+        slab->large = block;
+        return block + 1;
+    }
+    if (slab->free_lists[size_class]){
+        void *block = slab->free_lists[size_class];
+        slab->free_lists[size_class] = *(void **) block;
+        return block;
+    }
+    size_t block_size = SLAB_ALLOCATOR_MIN_BLOCK << size_class;
+    // blocks of a class are aligned to their size (up to 16 bytes).
+    size_t align = block_size < 16 ? block_size : 16;
+    size_t padding = (align - ((size_t) slab->cursor & (align - 1))) & (align - 1);
+    if (!slab->cursor || slab->remaining < padding + block_size){
+        void *new_slab = malloc(SLAB_ALLOCATOR_SLAB_SIZE);
+        if (!new_slab) return NULL;
+        *(void **) new_slab = slab->slabs;
+        slab->slabs = new_slab;
+        slab->cursor = (char *) new_slab + 16;
+        slab->remaining = SLAB_ALLOCATOR_SLAB_SIZE - 16;
+        padding = 0;
+    }
+    void *block = slab->cursor + padding;
+    slab->cursor += padding + block_size;
+    slab->remaining -= padding + block_size;
+    return block;
+}
+
+/*
+ * This function resizes a block. A block which stays in its size class is
+ * returned as is, otherwise it is moved to a new block.
+ */
+void *SlabResize(void *ctx, void *ptr, size_t old_size, size_t new_size){
+    SlabAllocator *slab = (SlabAllocator *) ctx;
+    if (!ptr) return SlabAlloc(ctx, new_size);
+    int old_class = SizeClass(old_size);
+    int new_class = SizeClass(new_size);
+    if (old_class != -1 && old_class == new_class) return ptr;
+    if (old_class == -1 && new_class == -1){
+        LargeBlock *block = (LargeBlock *) ptr - 1;
+        LargeBlock *prev = block->prev;
+        LargeBlock *next = block->next;
+        LargeBlock *temp = realloc(block, sizeof(LargeBlock) + new_size);
+        if (!temp) return NULL;
+        if (prev) prev->next = temp;
+        else slab->large = temp;
+        if (next) next->prev = temp;
+        return temp + 1;
+    }
+    void *new_block = SlabAlloc(ctx, new_size);
+    if (!new_block) return NULL;
+    memcpy(new_block, ptr, old_size < new_size ? old_size : new_size);
+    SlabRelease(ctx, ptr, old_size);
+    return new_block;
+}
+
+/*
+ * This function returns a block to the free list of its size class, bigger
+ * blocks are unlinked and freed.
+ */
+void SlabRelease(void *ctx, void *ptr, size_t size){
+    SlabAllocator *slab = (SlabAllocator *) ctx;
+    int size_class = SizeClass(size);
+    if (size_class == -1){
+        LargeBlock *block = (LargeBlock *) ptr - 1;
+        if (block->prev) block->prev->next = block->next;
+        else slab->large = block->next;
+        if (block->next) block->next->prev = block->prev;
+        free(block);
+        return;
+    }
+    *(void **) ptr = slab->free_lists[size_class];
+    slab->free_lists[size_class] = ptr;
+}
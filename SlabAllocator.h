@@ -0,0 +1,69 @@
+#ifndef SLABALLOCATOR_H_
+#define SLABALLOCATOR_H_
+
+#include <stdlib.h>
+#include "Allocator.h"
+
+/**
+ * @def SLAB_ALLOCATOR_SLAB_SIZE
+ * The size (in bytes) of every slab the small blocks are carved from.
+ */
+#define SLAB_ALLOCATOR_SLAB_SIZE 65536UL
+
+/**
+ * @def SLAB_ALLOCATOR_MIN_BLOCK
+ * The size of the smallest size class.
+ */
+#define SLAB_ALLOCATOR_MIN_BLOCK 8UL
+
+/**
+ * @def SLAB_ALLOCATOR_NUM_CLASSES
+ * The number of size classes (8, 16, 32, ..., 256 bytes).
+ * Bigger blocks are allocated with malloc, but are still released by
+ * SlabAllocatorFree.
+ */
+#define SLAB_ALLOCATOR_NUM_CLASSES 6
+
+/**
+ * @struct SlabAllocator - a pool allocator for small fixed-size blocks.
+ * Every size class keeps a free list of released blocks, new blocks are
+ * carved from big slabs, and everything is released at once by
+ * SlabAllocatorFree (so the per-block free is just a free list push).
+ * @param free_lists the released blocks of every size class.
+ * @param slabs linked list of the slabs.
+ * @param cursor the next free byte in the current slab.
+ * @param remaining the number of free bytes in the current slab.
+ * @param large doubly linked list of the blocks bigger than the size classes.
+ * @param allocator the Allocator interface of this slab allocator.
+ */
+typedef struct SlabAllocator {
+  void *free_lists[SLAB_ALLOCATOR_NUM_CLASSES];
+  void *slabs;
+  char *cursor;
+  size_t remaining;
+  void *large;
+  Allocator allocator;
+} SlabAllocator;
+
+/**
+ * Allocates dynamically a new (empty) slab allocator.
+ * @return pointer to dynamically allocated SlabAllocator.
+ * @if_fail return NULL.
+ */
+SlabAllocator *SlabAllocatorAlloc(void);
+
+/**
+ * Frees a slab allocator and *all* the blocks allocated from it, at once.
+ * @param p_slab pointer to dynamically allocated pointer to slab allocator.
+ */
+void SlabAllocatorFree(SlabAllocator **p_slab);
+
+/**
+ * Returns the Allocator interface of the slab allocator, to be passed to
+ * VectorAllocWith, HashMapAllocWith and as the allocator of a PairType.
+ * @param slab a slab allocator.
+ * @return the allocator interface (valid as long as the slab allocator is).
+ */
+const Allocator *SlabAllocatorGet(SlabAllocator *slab);
+
+#endif //SLABALLOCATOR_H_
@@ -0,0 +1,290 @@
+#ifndef TYPEDHASHMAP_H_
+#define TYPEDHASHMAP_H_
+
+#include <stdlib.h>
+#include <string.h>
+#include "Hash.h"
+
+/**
+ * Typed hash maps, generated at compile time.
+ * HASHMAP_DEFINE(K, V) defines the type HashMap_K_V and its functions
+ * (HashMap_K_V_Alloc, _Free, _Insert, _At, _ContainsKey, _Erase, _Size and
+ * _Clear). The keys and the values are stored by value in one slots array
+ * (Robin Hood, linear probing - like FlatHashMap), and the hash and compare
+ * functions are inlined, so there are no function pointers and no boxed
+ * keys or values. For example:
+ *
+ *   HASHMAP_DEFINE(char, int)
+ *   HashMap_char_int *map = HashMap_char_int_Alloc();
+ *   HashMap_char_int_Insert(map, 'a', 1);
+ *   int *value = HashMap_char_int_At(map, 'a');
+ *
+ * K and V must be single identifiers (typedef "unsigned int", "char *",
+ * structs and so on first). Use HASHMAP_DEFINE once per K, V in a program
+ * (or in every translation unit which needs it - all the functions are
+ * static inline).
+ */
+
+/**
+ * @def TYPED_HASH_MAP_INITIAL_CAP
+ * The initial capacity (number of slots) of a typed hash map.
+ */
+#define TYPED_HASH_MAP_INITIAL_CAP 16UL
+
+/**
+ * @def TYPED_HASH_MAP_GROWTH_FACTOR
+ * The growth factor of a typed hash map.
+ */
+#define TYPED_HASH_MAP_GROWTH_FACTOR 2UL
+
+/**
+ * @def TYPED_HASH_MAP_MAX_LOAD_FACTOR
+ * The maximal load factor a typed hash map can be in.
+ */
+#define TYPED_HASH_MAP_MAX_LOAD_FACTOR 0.875
+
+/**
+ * @def TYPED_HASH_MAP_EMPTY
+ * The hash of an empty slot. Stored hashes always have
+ * TYPED_HASH_MAP_USED_BIT set (the top bit, which never takes part in the
+ * slot index), so a slot needs no extra flag.
+ */
+#define TYPED_HASH_MAP_EMPTY ((size_t) 0)
+#define TYPED_HASH_MAP_USED_BIT ((size_t) 1 << (sizeof(size_t) * 8 - 1))
+
+/**
+ * @def TYPED_HASH_MAP_HASH_BYTES
+ * The default hash of keys - the bytes of the key (HashBytes).
+ */
+#define TYPED_HASH_MAP_HASH_BYTES(key) HashBytes(&(key), sizeof(key), HASH_SEED)
+
+/**
+ * @def TYPED_HASH_MAP_EQ_BYTES
+ * The default comparison of keys - the bytes of the keys (memcmp).
+ * Good for integers and pointers; keys with padding, floating point keys
+ * (-0.0 / NaN) and strings need HASHMAP_DEFINE_WITH.
+ */
+#define TYPED_HASH_MAP_EQ_BYTES(key_1, key_2) \
+  (memcmp(&(key_1), &(key_2), sizeof(key_1)) == 0)
+
+/**
+ * @def HASHMAP_DEFINE
+ * Defines HashMap_K_V, which hashes and compares the bytes of the keys.
+ */
+#define HASHMAP_DEFINE(K, V) \
+  HASHMAP_DEFINE_WITH(K, V, TYPED_HASH_MAP_HASH_BYTES, TYPED_HASH_MAP_EQ_BYTES)
+
+/**
+ * @def HASHMAP_DEFINE_WITH
+ * Defines HashMap_K_V with the given hash and compare functions (or function
+ * like macros): HASH(K key) returns size_t, EQ(K key_1, K key_2) returns 1
+ * if the keys are equal, 0 otherwise. Both are expanded inline. Like the hash
+ * funcs of HashMap, HASH is mixed by HashFinalize, so a weak HASH (e.g. one
+ * returning the key itself) does not cluster the probing.
+ */
+#define HASHMAP_DEFINE_WITH(K, V, HASH, EQ)                                       \
+typedef struct HashMap_##K##_##V##_Slot {                                         \
+  size_t hash;                                                                    \
+  K key;                                                                          \
+  V value;                                                                        \
+} HashMap_##K##_##V##_Slot;                                                       \
+                                                                                  \
+typedef struct HashMap_##K##_##V {                                                \
+  HashMap_##K##_##V##_Slot *slots;                                                \
+  size_t size;                                                                    \
+  size_t capacity;                                                                \
+} HashMap_##K##_##V;                                                              \
+                                                                                  \
+/* Hashes (and mixes) the key, the result is never TYPED_HASH_MAP_EMPTY. */       \
+static inline size_t HashMap_##K##_##V##_Hash(K key){                             \
+    return HashFinalize((size_t) HASH(key)) | TYPED_HASH_MAP_USED_BIT;            \
+}                                                                                 \
+                                                                                  \
+/* Returns the slot of the key, or capacity if the key is not in the map. */      \
+static inline size_t HashMap_##K##_##V##_FindSlot(                                \
+    const HashMap_##K##_##V *hash_map, K key){                                    \
+    size_t hash = HashMap_##K##_##V##_Hash(key);                                  \
+    size_t mask = hash_map->capacity - 1;                                         \
+    size_t pos = hash & mask;                                                     \
+    for (size_t dist = 0;; ++dist, pos = (pos + 1) & mask) {                      \
+        const HashMap_##K##_##V##_Slot *slot = &hash_map->slots[pos];             \
+        if (slot->hash == TYPED_HASH_MAP_EMPTY                                    \
+            || ((pos - (slot->hash & mask)) & mask) < dist){                      \
+            return hash_map->capacity;                                            \
+        }                                                                         \
+        if (slot->hash == hash && EQ(slot->key, key)) return pos;                 \
+    }                                                                             \
+}                                                                                 \
+                                                                                  \
+/* Places a slot whose key is not in the map (Robin Hood swapping). */            \
+static inline void HashMap_##K##_##V##_PlaceSlot(                                 \
+    HashMap_##K##_##V *hash_map, HashMap_##K##_##V##_Slot slot){                  \
+    size_t mask = hash_map->capacity - 1;                                         \
+    size_t pos = slot.hash & mask;                                                \
+    size_t dist = 0;                                                              \
+    while (hash_map->slots[pos].hash != TYPED_HASH_MAP_EMPTY) {                   \
+        size_t pos_dist = (pos - (hash_map->slots[pos].hash & mask)) & mask;      \
+        if (pos_dist < dist){                                                     \
+            HashMap_##K##_##V##_Slot temp = hash_map->slots[pos];                 \
+            hash_map->slots[pos] = slot;                                          \
+            slot = temp;                                                          \
+            dist = pos_dist;                                                      \
+        }                                                                         \
+        pos = (pos + 1) & mask;                                                   \
+        ++dist;                                                                   \
+    }                                                                             \
+    hash_map->slots[pos] = slot;                                                  \
+}                                                                                 \
+                                                                                  \
+/* Moves all the slots to a new slots array of new_capacity slots. */             \
+static inline int HashMap_##K##_##V##_Resize(                                     \
+    HashMap_##K##_##V *hash_map, size_t new_capacity){                            \
+    HashMap_##K##_##V##_Slot *new_slots =                                         \
+        calloc(new_capacity, sizeof(HashMap_##K##_##V##_Slot));                   \
+    if (!new_slots) return 0;                                                     \
+    HashMap_##K##_##V##_Slot *old_slots = hash_map->slots;                        \
+    size_t old_capacity = hash_map->capacity;                                     \
+    hash_map->slots = new_slots;                                                  \
+    hash_map->capacity = new_capacity;                                            \
+    for (size_t i = 0; i < old_capacity; ++i) {                                   \
+        if (old_slots[i].hash != TYPED_HASH_MAP_EMPTY){                           \
+            HashMap_##K##_##V##_PlaceSlot(hash_map, old_slots[i]);                \
+        }                                                                         \
+    }                                                                             \
+    free(old_slots);                                                              \
+    return 1;                                                                     \
+}                                                                                 \
+                                                                                  \
+/**                                                                               \
+ * Allocates dynamically new typed hash map element.                              \
+ * @return pointer to dynamically allocated HashMap_K_V.                          \
+ * @if_fail return NULL.                                                          \
+ */                                                                               \
+static inline HashMap_##K##_##V *HashMap_##K##_##V##_Alloc(void){                 \
+    HashMap_##K##_##V *hash_map = malloc(sizeof(HashMap_##K##_##V));              \
+    if (!hash_map) return NULL;                                                   \
+    hash_map->slots = calloc(TYPED_HASH_MAP_INITIAL_CAP,                          \
+                             sizeof(HashMap_##K##_##V##_Slot));                   \
+    if (!hash_map->slots){                                                        \
+        free(hash_map);                                                           \
+        return NULL;                                                              \
+    }                                                                             \
+    hash_map->size = 0;                                                           \
+    hash_map->capacity = TYPED_HASH_MAP_INITIAL_CAP;                              \
+    return hash_map;                                                              \
+}                                                                                 \
+                                                                                  \
+/**                                                                               \
+ * Frees a typed hash map.                                                        \
+ * @param p_hash_map pointer to dynamically allocated pointer to the map.         \
+ */                                                                               \
+static inline void HashMap_##K##_##V##_Free(HashMap_##K##_##V **p_hash_map){      \
+    if (!p_hash_map || !(*p_hash_map)) return;                                    \
+    free((*p_hash_map)->slots);                                                   \
+    free(*p_hash_map);                                                            \
+    *p_hash_map = NULL;                                                           \
+}                                                                                 \
+                                                                                  \
+/**                                                                               \
+ * Inserts the key and the value to the typed hash map. If the key already        \
+ * exists, its value is replaced.                                                 \
+ * @param hash_map the typed hash map.                                            \
+ * @param key the key of the new pair.                                            \
+ * @param value the value of the new pair.                                        \
+ * @return returns 1 for successful insertion, 0 otherwise.                       \
+ */                                                                               \
+static inline int HashMap_##K##_##V##_Insert(                                     \
+    HashMap_##K##_##V *hash_map, K key, V value){                                 \
+    if (!hash_map) return 0;                                                      \
+    size_t pos = HashMap_##K##_##V##_FindSlot(hash_map, key);                     \
+    if (pos != hash_map->capacity){                                               \
+        hash_map->slots[pos].value = value;                                       \
+        return 1;                                                                 \
+    }                                                                             \
+    if ((double) (hash_map->size + 1) / (double) hash_map->capacity               \
+        > TYPED_HASH_MAP_MAX_LOAD_FACTOR                                          \
+        && !HashMap_##K##_##V##_Resize(                                           \
+            hash_map, hash_map->capacity * TYPED_HASH_MAP_GROWTH_FACTOR)){        \
+        return 0;                                                                 \
+    }                                                                             \
+    HashMap_##K##_##V##_Slot slot;                                                \
+    slot.hash = HashMap_##K##_##V##_Hash(key);                                    \
+    slot.key = key;                                                               \
+    slot.value = value;                                                           \
+    HashMap_##K##_##V##_PlaceSlot(hash_map, slot);                                \
+    ++hash_map->size;                                                             \
+    return 1;                                                                     \
+}                                                                                 \
+                                                                                  \
+/**                                                                               \
+ * The function returns the value associated with the given key.                  \
+ * The pointer is valid until the next insertion or erasing.                      \
+ * @param hash_map the typed hash map.                                            \
+ * @param key the key to be checked.                                              \
+ * @return pointer to the value associated with key if exists, NULL otherwise.    \
+ */                                                                               \
+static inline V *HashMap_##K##_##V##_At(HashMap_##K##_##V *hash_map, K key){      \
+    if (!hash_map) return NULL;                                                   \
+    size_t pos = HashMap_##K##_##V##_FindSlot(hash_map, key);                     \
+    if (pos == hash_map->capacity) return NULL;                                   \
+    return &hash_map->slots[pos].value;                                           \
+}                                                                                 \
+                                                                                  \
+/**                                                                               \
+ * The function checks if the given key exists in the typed hash map.             \
+ * @param hash_map the typed hash map.                                            \
+ * @param key the key to be checked.                                              \
+ * @return 1 if the key is in the map, 0 otherwise.                               \
+ */                                                                               \
+static inline int HashMap_##K##_##V##_ContainsKey(                                \
+    HashMap_##K##_##V *hash_map, K key){                                          \
+    return HashMap_##K##_##V##_At(hash_map, key) != NULL;                         \
+}                                                                                 \
+                                                                                  \
+/**                                                                               \
+ * The function erases the pair associated with key (backward shift, so no        \
+ * tombstones are left behind).                                                   \
+ * @param hash_map the typed hash map.                                            \
+ * @param key a key of the pair to be erased.                                     \
+ * @return 1 if the erasing was done successfully, 0 otherwise.                   \
+ */                                                                               \
+static inline int HashMap_##K##_##V##_Erase(                                      \
+    HashMap_##K##_##V *hash_map, K key){                                          \
+    if (!hash_map) return 0;                                                      \
+    size_t pos = HashMap_##K##_##V##_FindSlot(hash_map, key);                     \
+    if (pos == hash_map->capacity) return 0;                                      \
+    size_t mask = hash_map->capacity - 1;                                         \
+    size_t next = (pos + 1) & mask;                                               \
+    while (hash_map->slots[next].hash != TYPED_HASH_MAP_EMPTY                     \
+           && ((next - (hash_map->slots[next].hash & mask)) & mask) != 0) {       \
+        hash_map->slots[pos] = hash_map->slots[next];                             \
+        pos = next;                                                               \
+        next = (next + 1) & mask;                                                 \
+    }                                                                             \
+    hash_map->slots[pos].hash = TYPED_HASH_MAP_EMPTY;                             \
+    --hash_map->size;                                                             \
+    return 1;                                                                     \
+}                                                                                 \
+                                                                                  \
+/**                                                                               \
+ * This function returns the number of pairs in the typed hash map.               \
+ * @param hash_map the typed hash map.                                            \
+ * @return the number of pairs in the map.                                        \
+ */                                                                               \
+static inline size_t HashMap_##K##_##V##_Size(const HashMap_##K##_##V *hash_map){ \
+    return hash_map ? hash_map->size : 0;                                         \
+}                                                                                 \
+                                                                                  \
+/**                                                                               \
+ * This function deletes all the elements in the typed hash map.                  \
+ * The capacity is kept.                                                          \
+ * @param hash_map the typed hash map to be cleared.                              \
+ */                                                                               \
+static inline void HashMap_##K##_##V##_Clear(HashMap_##K##_##V *hash_map){        \
+    if (!hash_map) return;                                                        \
+    memset(hash_map->slots, 0,                                                    \
+           hash_map->capacity * sizeof(HashMap_##K##_##V##_Slot));                \
+    hash_map->size = 0;                                                           \
+}                                                                                 \
+
+#endif //TYPEDHASHMAP_H_
@@ -0,0 +1,296 @@
+#include <string.h>
+#include "ValueIndex.h"
+#include "Hash.h"
+#define VALUE_HASH(index, value) HashFinalize((index)->value_hash(value))
+#define BUCKET_INDEX(hash, capacity) ((hash) & ((capacity)-1))
+#define PAIR_HOME(pair, capacity) \
+    ((size_t) HashMix64((uint64_t) (uintptr_t) (pair)) & ((capacity)-1))
+
+void *EntryCpy(const void *pair);
+int EntryCmp(const void *pair1, const void *pair2);
+void EntryFree(void **p_pair);
+Vector *GetEntries(ValueIndex *index, Vector **buckets, size_t ind);
+void ReleaseEntries(Vector **buckets, size_t size);
+int GrowIndex(ValueIndex *index);
+size_t FindPairSlot(ValueIndex *index, Pair *pair);
+void SetPairSlot(ValueIndex *index, Pair *pair, size_t slot);
+void RemovePairSlot(ValueIndex *index, size_t pos);
+int GrowPairSlots(ValueIndex *index);
+
+/**
+ * Allocates dynamically new (empty) value index.
+ * @param value_hash a function which "hashes" values.
+ * @param allocator the allocator of the index (NULL for malloc).
+ * @return pointer to dynamically allocated ValueIndex.
+ * @if_fail return NULL.
+ */
+ValueIndex *ValueIndexAlloc(ValueHashFunc value_hash, const Allocator *allocator){
+    if (!value_hash) return NULL;
+    ValueIndex *index = AllocatorAlloc(allocator, sizeof(ValueIndex));
+    if (!index) return NULL;
+    index->buckets = AllocatorCalloc(allocator,
+                                     VALUE_INDEX_INITIAL_CAP * sizeof(Vector *));
+    index->slots_capacity = VALUE_INDEX_INITIAL_CAP * 2;
+    index->slots = AllocatorCalloc(allocator,
+                                   index->slots_capacity * sizeof(ValueIndexSlot));
+    if (!index->buckets || !index->slots){
+        AllocatorFree(allocator, index->buckets, VALUE_INDEX_INITIAL_CAP * sizeof(Vector *));
+        AllocatorFree(allocator, index->slots,
+                      index->slots_capacity * sizeof(ValueIndexSlot));
+        AllocatorFree(allocator, index, sizeof(ValueIndex));
+        return NULL;
+    }
+    index->size = 0;
+    index->capacity = VALUE_INDEX_INITIAL_CAP;
+    index->value_hash = value_hash;
+    index->allocator = allocator;
+    return index;
+}
+
+/**
+ * Frees the value index (NOT the pairs it points to).
+ * @param p_index pointer to dynamically allocated pointer to value index.
+ */
+void ValueIndexFree(ValueIndex **p_index){
+    if (!p_index || !(*p_index)) return;
+    ReleaseEntries((*p_index)->buckets, (*p_index)->capacity);
+    AllocatorFree((*p_index)->allocator, (*p_index)->buckets,
+                  (*p_index)->capacity * sizeof(Vector *));
+    AllocatorFree((*p_index)->allocator, (*p_index)->slots,
+                  (*p_index)->slots_capacity * sizeof(ValueIndexSlot));
+    AllocatorFree((*p_index)->allocator, *p_index, sizeof(ValueIndex));
+    *p_index = NULL;
+}
+
+/**
+ * Adds the pair to the index (by its current value). Pairs with a NULL value
+ * are not indexed (no value can be looked up as NULL).
+ * @param index a value index.
+ * @param pair a pair (stored elsewhere).
+ * @return 1 for success, 0 otherwise.
+ */
+int ValueIndexAdd(ValueIndex *index, Pair *pair){
+    if (!index || !pair) return 0;
+    if (!pair->value) return 1;
+    if (index->capacity * VALUE_INDEX_MAX_LOAD_FACTOR < (double) index->size + 1){
+        GrowIndex(index); // on failure the index just gets more loaded.
+    }
+    if (index->slots_capacity * VALUE_INDEX_MAX_SLOTS_LOAD_FACTOR < (double) index->size + 1
+        && GrowPairSlots(index) == 0){
+        return 0;
+    }
+    size_t ind = BUCKET_INDEX(VALUE_HASH(index, pair->value), index->capacity);
+    Vector *entries = GetEntries(index, index->buckets, ind);
+    if (VectorPushBackMove(entries, pair) == 0){
+        return 0;
+    }
+    SetPairSlot(index, pair, entries->size - 1);
+    index->size++;
+    return 1;
+}
+
+/**
+ * Removes the pair (this very pair, not an equal one) from the index, in O(1)
+ * (its position is found in the slots of the index).
+ * Must be called before the value of the pair is changed or freed.
+ * @param index a value index.
+ * @param pair a pair which was added to the index.
+ * @return 1 if the pair was removed, 0 otherwise.
+ */
+int ValueIndexRemove(ValueIndex *index, Pair *pair){
+    if (!index || !pair || !pair->value) return 0;
+    size_t ind = BUCKET_INDEX(VALUE_HASH(index, pair->value), index->capacity);
+    Vector *entries = index->buckets[ind];
+    size_t pos = FindPairSlot(index, pair);
+    if (pos == index->slots_capacity) return 0;
+    size_t slot = index->slots[pos].slot;
+    if (!entries || slot >= entries->size || entries->data[slot] != pair) return 0;
+    VectorSwapRemove(entries, slot); // the vector does not free pairs.
+    RemovePairSlot(index, pos);
+    if (slot < entries->size){ // the last pair of the bucket moved to slot.
+        index->slots[FindPairSlot(index, (Pair *) entries->data[slot])].slot = slot;
+    }
+    index->size--;
+    return 1;
+}
+
+/**
+ * Finds a pair whose value equals the given value.
+ * @param index a value index.
+ * @param value the value to look for.
+ * @return a pair with this value (the pair itself), NULL if there is none.
+ */
+Pair *ValueIndexFind(ValueIndex *index, ValueT value){
+    if (!index || !value) return NULL;
+    Vector *entries = index->buckets[BUCKET_INDEX(VALUE_HASH(index, value),
+                                                  index->capacity)];
+    if (!entries) return NULL;
+    for (size_t i = 0; i < entries->size; ++i) {
+        Pair *pair = (Pair *) entries->data[i];
+        if (pair->type->value_cmp(pair->value, value) == 1) return pair;
+    }
+    return NULL;
+}
+
+/**
+ * Counts the pairs whose value equals the given value.
+ * @param index a value index.
+ * @param value the value to look for.
+ * @return the number of pairs with this value.
+ */
+size_t ValueIndexCount(ValueIndex *index, ValueT value){
+    if (!index || !value) return 0;
+    Vector *entries = index->buckets[BUCKET_INDEX(VALUE_HASH(index, value),
+                                                  index->capacity)];
+    if (!entries) return 0;
+    size_t count = 0;
+    for (size_t i = 0; i < entries->size; ++i) {
+        Pair *pair = (Pair *) entries->data[i];
+        if (pair->type->value_cmp(pair->value, value) == 1) count++;
+    }
+    return count;
+}
+
+/**
+ * Removes all the pairs from the index (keeping its buckets).
+ * @param index a value index.
+ */
+void ValueIndexClear(ValueIndex *index){
+    if (!index) return;
+    ReleaseEntries(index->buckets, index->capacity);
+    memset(index->slots, 0, index->slots_capacity * sizeof(ValueIndexSlot));
+    index->size = 0;
+}
+
+/*
+ * The index holds pointers to pairs owned by a hash map, so its vectors never
+ * copy or free them.
+ */
+void *EntryCpy(const void *pair){
+    return (void *) pair;
+}
+
+int EntryCmp(const void *pair1, const void *pair2){
+    return pair1 == pair2;
+}
+
+void EntryFree(void **p_pair){
+    if (p_pair) *p_pair = NULL;
+}
+
+/*
+ * This function returns the bucket at the given index, allocating it on first
+ * use. Returns NULL for failure.
+ */
+Vector *GetEntries(ValueIndex *index, Vector **buckets, size_t ind){
+    if (!buckets[ind]){
+        buckets[ind] = VectorAllocWith(EntryCpy, EntryCmp, EntryFree, index->allocator);
+    }
+    return buckets[ind];
+}
+
+/*
+ * This function frees the buckets (the vectors), not the pairs, and sets them
+ * to NULL.
+ */
+void ReleaseEntries(Vector **buckets, size_t size){
+    for (size_t i = 0; i < size; ++i) {
+        VectorRelease(&buckets[i]);
+    }
+}
+
+/*
+ * This function moves the pairs to new buckets VALUE_INDEX_GROWTH_FACTOR
+ * times bigger. Returns 1 for success, 0 for failure (the index is unchanged).
+ */
+int GrowIndex(ValueIndex *index){
+    size_t new_cap = index->capacity * VALUE_INDEX_GROWTH_FACTOR;
+    Vector **temp = AllocatorCalloc(index->allocator, new_cap * sizeof(Vector *));
+    if (!temp) return 0;
+    for (size_t i = 0; i < index->capacity; ++i) {
+        Vector *entries = index->buckets[i];
+        if (!entries) continue;
+        for (size_t j = 0; j < entries->size; ++j) {
+            Pair *pair = (Pair *) entries->data[j];
+            size_t ind = BUCKET_INDEX(VALUE_HASH(index, pair->value), new_cap);
+            if (VectorPushBackMove(GetEntries(index, temp, ind), pair) == 0){
+                ReleaseEntries(temp, new_cap);
+                AllocatorFree(index->allocator, temp, new_cap * sizeof(Vector *));
+                return 0;
+            }
+        }
+    }
+    // the slots are set only after success, the old ones stay valid on failure.
+    for (size_t i = 0; i < new_cap; ++i) {
+        for (size_t j = 0; temp[i] && j < temp[i]->size; ++j) {
+            index->slots[FindPairSlot(index, (Pair *) temp[i]->data[j])].slot = j;
+        }
+    }
+    ReleaseEntries(index->buckets, index->capacity);
+    AllocatorFree(index->allocator, index->buckets, index->capacity * sizeof(Vector *));
+    index->buckets = temp;
+    index->capacity = new_cap;
+    return 1;
+}
+
+/*
+ * This function returns the position of the pair in the slots table, or
+ * slots_capacity if the pair is not indexed.
+ */
+size_t FindPairSlot(ValueIndex *index, Pair *pair){
+    size_t mask = index->slots_capacity - 1;
+    for (size_t pos = PAIR_HOME(pair, index->slots_capacity);; pos = (pos + 1) & mask) {
+        if (index->slots[pos].pair == pair) return pos;
+        if (!index->slots[pos].pair) return index->slots_capacity;
+    }
+}
+
+/*
+ * This function sets the slot of the pair, adding it to the slots table if
+ * it is not there (the table must have a free slot).
+ */
+void SetPairSlot(ValueIndex *index, Pair *pair, size_t slot){
+    size_t mask = index->slots_capacity - 1;
+    size_t pos = PAIR_HOME(pair, index->slots_capacity);
+    while (index->slots[pos].pair && index->slots[pos].pair != pair) {
+        pos = (pos + 1) & mask;
+    }
+    index->slots[pos].pair = pair;
+    index->slots[pos].slot = slot;
+}
+
+/*
+ * This function empties the given position of the slots table, shifting back
+ * the following slots which may move (no tombstones, like FlatHashMap).
+ */
+void RemovePairSlot(ValueIndex *index, size_t pos){
+    size_t mask = index->slots_capacity - 1;
+    for (size_t next = (pos + 1) & mask; index->slots[next].pair; next = (next + 1) & mask) {
+        size_t home = PAIR_HOME(index->slots[next].pair, index->slots_capacity);
+        // the pair at next may fill pos only if pos is on its probe sequence.
+        if (((pos - home) & mask) < ((next - home) & mask)){
+            index->slots[pos] = index->slots[next];
+            pos = next;
+        }
+    }
+    index->slots[pos].pair = NULL;
+}
+
+/*
+ * This function moves the slots to a table VALUE_INDEX_GROWTH_FACTOR times
+ * bigger. Returns 1 for success, 0 for failure (the index is unchanged).
+ */
+int GrowPairSlots(ValueIndex *index){
+    size_t old_cap = index->slots_capacity;
+    ValueIndexSlot *old_slots = index->slots;
+    size_t new_cap = old_cap * VALUE_INDEX_GROWTH_FACTOR;
+    ValueIndexSlot *temp = AllocatorCalloc(index->allocator, new_cap * sizeof(ValueIndexSlot));
+    if (!temp) return 0;
+    index->slots = temp;
+    index->slots_capacity = new_cap;
+    for (size_t i = 0; i < old_cap; ++i) {
+        if (old_slots[i].pair) SetPairSlot(index, old_slots[i].pair, old_slots[i].slot);
+    }
+    AllocatorFree(index->allocator, old_slots, old_cap * sizeof(ValueIndexSlot));
+    return 1;
+}
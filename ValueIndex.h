@@ -0,0 +1,131 @@
+#ifndef VALUEINDEX_H_
+#define VALUEINDEX_H_
+
+#include <stdlib.h>
+#include "Vector.h"
+#include "Pair.h"
+
+/**
+ * @def VALUE_INDEX_INITIAL_CAP
+ * The initial number of buckets of the value index.
+ */
+#define VALUE_INDEX_INITIAL_CAP 16UL
+
+/**
+ * @def VALUE_INDEX_GROWTH_FACTOR
+ * The growth factor of the value index.
+ */
+#define VALUE_INDEX_GROWTH_FACTOR 2UL
+
+/**
+ * @def VALUE_INDEX_MAX_LOAD_FACTOR
+ * The maximal load factor of the value index (it only grows, like a hash map
+ * with HASH_MAP_SHRINK_NEVER).
+ */
+#define VALUE_INDEX_MAX_LOAD_FACTOR 1.0
+
+/**
+ * @def VALUE_INDEX_MAX_SLOTS_LOAD_FACTOR
+ * The maximal load factor of the slots table of the value index.
+ */
+#define VALUE_INDEX_MAX_SLOTS_LOAD_FACTOR 0.5
+
+/**
+ * @typedef ValueHashFunc
+ * A function which "hashes" values (the HashFunc of the values).
+ */
+typedef size_t (*ValueHashFunc)(ValueT);
+
+/**
+ * @struct ValueIndexSlot - where an indexed pair is: a slot of the open
+ * addressing (linear probing) table of the value index, keyed by the pair
+ * pointer.
+ * @param pair the pair, NULL if the slot is empty.
+ * @param slot the index of the pair in its bucket (vector) of the index.
+ */
+typedef struct ValueIndexSlot {
+  Pair *pair;
+  size_t slot;
+} ValueIndexSlot;
+
+/**
+ * @struct ValueIndex - a reverse index of pairs by their values.
+ * It does not own the pairs: it only points to the pairs stored in a hash
+ * map, so every pair must be removed before it is freed or its value changes.
+ * The index keeps where every pair is (slots), so removing a pair is O(1)
+ * however many pairs share its value, and the pairs themselves carry nothing.
+ * @param buckets dynamic array of vectors of pairs (NULL until used).
+ * @param size the number of pairs in the index.
+ * @param capacity the number of buckets.
+ * @param slots the positions of the pairs in the buckets (power of 2 table).
+ * @param slots_capacity the number of slots.
+ * @param value_hash a function which "hashes" values.
+ * @param allocator the allocator of the index (NULL for malloc).
+ */
+typedef struct ValueIndex {
+  Vector **buckets;
+  size_t size;
+  size_t capacity;
+  ValueIndexSlot *slots;
+  size_t slots_capacity;
+  ValueHashFunc value_hash;
+  const Allocator *allocator;
+} ValueIndex;
+
+/**
+ * Allocates dynamically new (empty) value index.
+ * @param value_hash a function which "hashes" values.
+ * @param allocator the allocator of the index (NULL for malloc).
+ * @return pointer to dynamically allocated ValueIndex.
+ * @if_fail return NULL.
+ */
+ValueIndex *ValueIndexAlloc(ValueHashFunc value_hash, const Allocator *allocator);
+
+/**
+ * Frees the value index (NOT the pairs it points to).
+ * @param p_index pointer to dynamically allocated pointer to value index.
+ */
+void ValueIndexFree(ValueIndex **p_index);
+
+/**
+ * Adds the pair to the index (by its current value). Pairs with a NULL value
+ * are not indexed (no value can be looked up as NULL).
+ * @param index a value index.
+ * @param pair a pair (stored elsewhere).
+ * @return 1 for success, 0 otherwise.
+ */
+int ValueIndexAdd(ValueIndex *index, Pair *pair);
+
+/**
+ * Removes the pair (this very pair, not an equal one) from the index, in O(1)
+ * (its position is found in the slots of the index).
+ * Must be called before the value of the pair is changed or freed.
+ * @param index a value index.
+ * @param pair a pair which was added to the index.
+ * @return 1 if the pair was removed, 0 otherwise.
+ */
+int ValueIndexRemove(ValueIndex *index, Pair *pair);
+
+/**
+ * Finds a pair whose value equals the given value.
+ * @param index a value index.
+ * @param value the value to look for.
+ * @return a pair with this value (the pair itself), NULL if there is none.
+ */
+Pair *ValueIndexFind(ValueIndex *index, ValueT value);
+
+/**
+ * Counts the pairs whose value equals the given value.
+ * @param index a value index.
+ * @param value the value to look for.
+ * @return the number of pairs with this value.
+ */
+size_t ValueIndexCount(ValueIndex *index, ValueT value);
+
+/**
+ * Removes all the pairs from the index (keeping its buckets).
+ * @param index a value index.
+ */
+void ValueIndexClear(ValueIndex *index);
+
+#endif //VALUEINDEX_H_
@@ -2,8 +2,14 @@
 // Created by Raz on 03/12/2020.
 //
 
+#include <string.h>
 #include "Vector.h"
 
+void *RemoveAt(Vector *vector, size_t ind);
+int ShrinkIfNeeded(Vector *vector);
+int ResizeData(Vector *vector, size_t new_cap);
+int GrowFor(Vector *vector, size_t n);
+
 /**
  * Allocates dynamically new vector element.
  * @param elem_copy_func func which copies the element stored in the vector (returns
@@ -14,12 +20,28 @@
  * @if_fail return NULL.
  */
 Vector *VectorAlloc(VectorElemCpy elem_copy_func, VectorElemCmp elem_cmp_func, VectorElemFree elem_free_func){
+    return VectorAllocWith(elem_copy_func, elem_cmp_func, elem_free_func, NULL);
+}
+
+/**
+ * Allocates dynamically new vector element, using the given allocator for the
+ * vector and its data (the elements are still copied by elem_copy_func).
+ * @param elem_copy_func func which copies the element stored in the vector (returns
+ * dynamically allocated copy).
+ * @param elem_cmp_func func which is used to compare elements stored in the vector.
+ * @param elem_free_func func which frees elements stored in the vector.
+ * @param allocator the allocator to use (NULL for malloc).
+ * @return pointer to dynamically allocated vector.
+ * @if_fail return NULL.
+ */
+Vector *VectorAllocWith(VectorElemCpy elem_copy_func, VectorElemCmp elem_cmp_func,
+                        VectorElemFree elem_free_func, const Allocator *allocator){
     if (!elem_copy_func || !elem_cmp_func || !elem_free_func) return NULL;
-    Vector * new_vector = malloc(sizeof(Vector));
+    Vector * new_vector = AllocatorAlloc(allocator, sizeof(Vector));
     if (!new_vector) return NULL;
-    new_vector->data = malloc(VECTOR_INITIAL_CAP * sizeof(void *));
+    new_vector->data = AllocatorAlloc(allocator, VECTOR_INITIAL_CAP * sizeof(void *));
     if (!new_vector->data){
-        free(new_vector);
+        AllocatorFree(allocator, new_vector, sizeof(Vector));
         return NULL;
     }
     new_vector->capacity = VECTOR_INITIAL_CAP;
@@ -27,6 +49,8 @@ Vector *VectorAlloc(VectorElemCpy elem_copy_func, VectorElemCmp elem_cmp_func, V
     new_vector->elem_copy_func = elem_copy_func;
     new_vector->elem_cmp_func = elem_cmp_func;
     new_vector->elem_free_func = elem_free_func;
+    new_vector->allocator = allocator;
+    new_vector->growth_factor = VECTOR_GROWTH_FACTOR;
     return new_vector;
 }
 
@@ -67,17 +91,96 @@ int VectorFind(Vector *vector, void *value){
  */
 int VectorPushBack(Vector *vector, void *value){
     if (!vector || !value) return 0;
-    if (vector->capacity * VECTOR_MAX_LOAD_FACTOR < (double) vector->size + 1){
-        vector->capacity *= VECTOR_GROWTH_FACTOR;
-        void ** temp = realloc(vector->data, vector->capacity * sizeof(void *));
-        if (!temp) return 0;
-        vector->data = temp;
-        temp = NULL;
+    void *copy = vector->elem_copy_func(value);
+    if (!copy) return 0;
+    if (VectorPushBackMove(vector, copy) == 0){
+        vector->elem_free_func(&copy);
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * Adds the given value to the back of the vector *without* copying it.
+ * The vector takes ownership of the value (it would be freed with
+ * elem_free_func), so the caller must not free it afterwards.
+ * @param vector a pointer to vector.
+ * @param value dynamically allocated value to be moved into the vector.
+ * @return 1 if the adding has been done successfully, 0 otherwise.
+ */
+int VectorPushBackMove(Vector *vector, void *value){
+    if (!vector || !value) return 0;
+    if (GrowFor(vector, 1) == 0) return 0;
+    vector->data[vector->size++] = value;
+    return 1;
+}
+
+/**
+ * Adds copies of n values to the back of the vector. The capacity is
+ * checked (and increased) once for all the values.
+ * @param vector a pointer to vector.
+ * @param elems array of n values to be added.
+ * @param n the number of values.
+ * @return 1 if all the values were added, 0 otherwise (then none is added).
+ */
+int VectorAppend(Vector *vector, void **elems, size_t n){
+    if (!vector || (!elems && n > 0)) return 0;
+    if (GrowFor(vector, n) == 0) return 0;
+    size_t size = vector->size;
+    for (size_t i = 0; i < n; ++i) {
+        void *copy = elems[i] ? vector->elem_copy_func(elems[i]) : NULL;
+        if (!copy){
+            for (size_t j = size; j < size + i; ++j) {
+                vector->elem_free_func(&vector->data[j]);
+            }
+            return 0;
+        }
+        vector->data[size + i] = copy;
+    }
+    vector->size += n;
+    return 1;
+}
+
+/**
+ * Adds a copy of the value at the given index, moving the following elements
+ * once.
+ * @param vector a pointer to vector.
+ * @param ind the index of the new element ([0, vector_size]).
+ * @param value the value to be added.
+ * @return 1 if the adding has been done successfully, 0 otherwise.
+ */
+int VectorInsertAt(Vector *vector, size_t ind, void *value){
+    if (!vector || !value) return 0;
+    if (ind > vector->size) return 0;
+    void *copy = vector->elem_copy_func(value);
+    if (!copy) return 0;
+    if (GrowFor(vector, 1) == 0){
+        vector->elem_free_func(&copy);
+        return 0;
     }
-    vector->data[vector->size++] = vector->elem_copy_func(value);
+    memmove(&vector->data[ind+1], &vector->data[ind],
+            (vector->size - ind) * sizeof(void *));
+    vector->data[ind] = copy;
+    vector->size++;
     return 1;
 }
 
+/**
+ * Adds copies of all the elements of src to the back of dst (copied by the
+ * elem_copy_func of dst), like VectorAppend.
+ * @param dst a pointer to the vector to be extended.
+ * @param src a pointer to the vector whose elements are added (may be dst).
+ * @return 1 if all the elements were added, 0 otherwise (then none is added).
+ */
+int VectorExtend(Vector *dst, Vector *src){
+    if (!dst || !src) return 0;
+    if (dst == src){
+        // the data of src moves when dst grows, so grow first.
+        if (GrowFor(dst, src->size) == 0) return 0;
+    }
+    return VectorAppend(dst, src->data, src->size);
+}
+
 /**
  * This function returns the load factor of the vector.
  * @param vector a vector.
@@ -100,20 +203,95 @@ void VectorFree(Vector **p_vector){
     for (size_t i = 0; i < (*p_vector)->size; ++i) {
         (*p_vector)->elem_free_func(&(*p_vector)->data[i]);
     }
-    free((*p_vector)->data);
-    free(*p_vector);
+    const Allocator *allocator = (*p_vector)->allocator;
+    AllocatorFree(allocator, (*p_vector)->data, (*p_vector)->capacity * sizeof(void *));
+    AllocatorFree(allocator, *p_vector, sizeof(Vector));
+    *p_vector = NULL;
+}
+
+/**
+ * Frees a vector *without* freeing the elements stored in it.
+ * Used when the elements were moved to another owner.
+ * @param p_vector pointer to dynamically allocated pointer to vector.
+ */
+void VectorRelease(Vector **p_vector){
+    if (!p_vector || !(*p_vector)){
+        return;
+    }
+    const Allocator *allocator = (*p_vector)->allocator;
+    AllocatorFree(allocator, (*p_vector)->data, (*p_vector)->capacity * sizeof(void *));
+    AllocatorFree(allocator, *p_vector, sizeof(Vector));
     *p_vector = NULL;
 }
 
 /**
- * Deletes all the elements in the vector.
+ * Deletes all the elements in the vector (and decreases its capacity once).
  * @param vector vector a pointer to vector.
  */
 void VectorClear(Vector *vector){
     if (!vector || vector->size == 0) return;
-    for (long i = (long) vector->size-1; i >= 0; --i) {
-        if (VectorErase(vector, i) == 0) return;
+    VectorEraseRange(vector, 0, vector->size);
+}
+
+/**
+ * Removes the elements at the indices [first, last) from the vector, moving
+ * the following elements once.
+ * @param vector a pointer to vector.
+ * @param first the index of the first element to be removed.
+ * @param last the index after the last element to be removed.
+ * @return 1 if the removing has been done successfully, 0 otherwise.
+ */
+int VectorEraseRange(Vector *vector, size_t first, size_t last){
+    if (!vector) return 0;
+    if (first > last || last > vector->size) return 0;
+    if (first == last) return 1;
+    for (size_t i = first; i < last; ++i) {
+        vector->elem_free_func(&vector->data[i]);
     }
+    memmove(&vector->data[first], &vector->data[last],
+            (vector->size - last) * sizeof(void *));
+    vector->size -= last - first;
+    return ShrinkIfNeeded(vector);
+}
+
+/**
+ * Removes (and frees) every element for which pred returns 1, in one pass
+ * which keeps the order of the remaining elements.
+ * @param vector a pointer to vector.
+ * @param pred a function which is called with every element and ctx.
+ * @param ctx a context passed to pred.
+ * @return the number of removed elements.
+ */
+size_t VectorRemoveIf(Vector *vector, VectorElemPred pred, void *ctx){
+    if (!vector || !pred) return 0;
+    size_t kept = 0;
+    for (size_t i = 0; i < vector->size; ++i) {
+        if (pred(vector->data[i], ctx) == 1){
+            vector->elem_free_func(&vector->data[i]);
+        }
+        else {
+            vector->data[kept++] = vector->data[i];
+        }
+    }
+    size_t removed = vector->size - kept;
+    vector->size = kept;
+    if (removed > 0) ShrinkIfNeeded(vector); // on failure the data is still valid.
+    return removed;
+}
+
+/**
+ * Removes the element at the given index from the vector in O(1), by moving
+ * the last element to its place (so the order of the elements changes).
+ * @param vector a pointer to vector.
+ * @param ind the index of the element to be removed.
+ * @return 1 if the removing has been done successfully, 0 otherwise.
+ */
+int VectorSwapRemove(Vector *vector, size_t ind){
+    if (!vector) return 0;
+    if (ind >= vector->size) return 0;
+    vector->elem_free_func(&vector->data[ind]);
+    vector->data[ind] = vector->data[--vector->size];
+    return ShrinkIfNeeded(vector);
 }
 
 /**
@@ -124,18 +302,120 @@ void VectorClear(Vector *vector){
  */
 int VectorErase(Vector *vector, size_t ind){
     if (!vector) return 0;
-    if (ind > vector->size-1) return 0;
-    vector->elem_free_func(&vector->data[ind]);
-    for (size_t i = ind; i < vector->size-1; ++i) {
-        vector->data[i] = vector->data[i+1];
-    }
+    if (ind >= vector->size) return 0;
+    void *elem = RemoveAt(vector, ind);
+    vector->elem_free_func(&elem);
+    return ShrinkIfNeeded(vector);
+}
+
+/**
+ * Removes the element at the given index from the vector *without* freeing
+ * it, and returns it (the caller owns it afterwards).
+ * @param vector a pointer to vector.
+ * @param ind the index of the element to be removed.
+ * @return the removed element, NULL for failure.
+ */
+void *VectorTakeAt(Vector *vector, size_t ind){
+    if (!vector) return NULL;
+    if (ind >= vector->size) return NULL;
+    void *elem = RemoveAt(vector, ind);
+    ShrinkIfNeeded(vector); // on failure the (bigger) data is still valid.
+    return elem;
+}
+
+/*
+ * This function removes the element at the given index from the data of the
+ * vector, shifting the following elements, and returns it.
+ */
+void *RemoveAt(Vector *vector, size_t ind){
+    void *elem = vector->data[ind];
+    memmove(&vector->data[ind], &vector->data[ind+1],
+            (vector->size - ind - 1) * sizeof(void *));
     vector->size -= 1;
+    return elem;
+}
+
+/*
+ * This function decreases the capacity of the vector to
+ * VECTOR_SHRINK_TARGET_LOAD_FACTOR (but not below VECTOR_INITIAL_CAP) if its
+ * load factor dropped below VECTOR_MIN_LOAD_FACTOR.
+ * Returns 1 for success, 0 for failure.
+ */
+int ShrinkIfNeeded(Vector *vector){
     if (VectorGetLoadFactor(vector) < VECTOR_MIN_LOAD_FACTOR){
-        vector->capacity /= VECTOR_GROWTH_FACTOR;
-        void ** temp = realloc(vector->data, vector->capacity * sizeof(void *));
-        if (!temp) return 0;
-        vector->data = temp;
-        temp = NULL;
+        size_t new_cap = (size_t) ((double) vector->size /
+                                   VECTOR_SHRINK_TARGET_LOAD_FACTOR);
+        if (new_cap < VECTOR_INITIAL_CAP) new_cap = VECTOR_INITIAL_CAP;
+        if (new_cap >= vector->capacity) return 1;
+        return ResizeData(vector, new_cap);
     }
     return 1;
+}
+
+/*
+ * This function reallocates the data of the vector to new_cap elements
+ * (new_cap >= size, > 0). Returns 1 for success, 0 for failure (the data is
+ * unchanged).
+ */
+int ResizeData(Vector *vector, size_t new_cap){
+    void ** temp = AllocatorResize(vector->allocator, vector->data,
+                                   vector->capacity * sizeof(void *),
+                                   new_cap * sizeof(void *));
+    if (!temp) return 0;
+    vector->capacity = new_cap;
+    vector->data = temp;
+    temp = NULL;
+    return 1;
+}
+
+/*
+ * This function makes room for n more elements in the vector, growing it
+ * at least by its growth factor (so repeated small appends stay amortized
+ * O(1)). Returns 1 for success, 0 for failure (the data is unchanged).
+ */
+int GrowFor(Vector *vector, size_t n){
+    size_t needed = vector->size + n;
+    if (needed <= vector->capacity * VECTOR_MAX_LOAD_FACTOR) return 1;
+    size_t new_cap = (size_t) ((double) vector->capacity * vector->growth_factor);
+    if (new_cap < needed) new_cap = needed;
+    return ResizeData(vector, new_cap);
+}
+
+/**
+ * Makes room for at least n elements in the vector, so pushing up to n
+ * elements does not reallocate its data.
+ * @param vector a pointer to vector.
+ * @param n the number of elements the vector should hold.
+ * @return 1 for success, 0 otherwise.
+ */
+int VectorReserve(Vector *vector, size_t n){
+    if (!vector) return 0;
+    if (n <= vector->capacity) return 1;
+    return ResizeData(vector, n);
+}
+
+/**
+ * Decreases the capacity of the vector to its size (at least 1).
+ * @param vector a pointer to vector.
+ * @return 1 for success, 0 otherwise.
+ */
+int VectorShrinkToFit(Vector *vector){
+    if (!vector) return 0;
+    size_t new_cap = vector->size > 0 ? vector->size : 1;
+    if (new_cap >= vector->capacity) return 1;
+    return ResizeData(vector, new_cap);
+}
+
+/**
+ * Sets the factor the capacity is multiplied by when the vector is full
+ * (VECTOR_GROWTH_FACTOR by default). Smaller factors, like 1.5, waste less
+ * memory and let allocators reuse the freed blocks.
+ * @param vector a pointer to vector.
+ * @param growth_factor the growth factor, bigger than 1.
+ * @return 1 for success, 0 otherwise.
+ */
+int VectorSetGrowthFactor(Vector *vector, double growth_factor){
+    if (!vector || !(growth_factor > 1)) return 0;
+    vector->growth_factor = growth_factor;
+    return 1;
 }
\ No newline at end of file
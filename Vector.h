@@ -2,6 +2,7 @@
 #define VECTOR_H_
 
 #include <stdlib.h>
+#include "Allocator.h"
 
 /**
  * @def VECTOR_INITIAL_CAP
@@ -11,16 +12,16 @@
 
 /**
  * @def VECTOR_GROWTH_FACTOR
- * The growth factor of the vector.
+ * The default growth factor of the vector (see VectorSetGrowthFactor).
  */
-#define VECTOR_GROWTH_FACTOR 2UL
+#define VECTOR_GROWTH_FACTOR 2.0
 
 /**
  * @def VECTOR_MAX_LOAD_FACTOR
  * The maximal load factor the vector can be in before
- * extension (vector need to be extended if the load factor is >0.75).
+ * extension (the vector is extended only when it is full).
  */
-#define VECTOR_MAX_LOAD_FACTOR 0.75
+#define VECTOR_MAX_LOAD_FACTOR 1.0
 
 /**
  * @def VECTOR_MIN_LOAD_FACTOR
@@ -29,6 +30,14 @@
  */
 #define VECTOR_MIN_LOAD_FACTOR 0.25
 
+/**
+ * @def VECTOR_SHRINK_TARGET_LOAD_FACTOR
+ * The load factor the vector is decreased to (not below VECTOR_INITIAL_CAP),
+ * so it is far from both the growing and the decreasing points, and pushing
+ * and erasing around one of them does not reallocate the data every time.
+ */
+#define VECTOR_SHRINK_TARGET_LOAD_FACTOR 0.5
+
 /**
  * @typedef VectorElemCpy
  * Function which receive an element stored in the vector
@@ -50,6 +59,13 @@ typedef int (*VectorElemCmp)(const void *, const void *);
  */
 typedef void (*VectorElemFree)(void **);
 
+/**
+ * @typedef VectorElemPred
+ * Function which receives an element stored in the vector and a context,
+ * and returns 1 if the element should be removed (see VectorRemoveIf).
+ */
+typedef int (*VectorElemPred)(const void *, void *);
+
 /**
  * @struct Vector - a generic vector struct.
  * @param capacity - the capacity of the vector.
@@ -61,6 +77,10 @@ typedef void (*VectorElemFree)(void **);
  * stored in the vector.
  * @param elem_free_func - a function which frees the elements stored
  * in the vector.
+ * @param allocator - the allocator of the vector itself and its data
+ * (NULL for malloc).
+ * @param growth_factor - the factor the capacity is multiplied by when the
+ * vector is full.
  */
 typedef struct Vector {
   size_t capacity;
@@ -69,6 +89,8 @@ typedef struct Vector {
   VectorElemCpy elem_copy_func;
   VectorElemCmp elem_cmp_func;
   VectorElemFree elem_free_func;
+  const Allocator *allocator;
+  double growth_factor;
 } Vector;
 
 /**
@@ -82,6 +104,20 @@ typedef struct Vector {
  */
 Vector *VectorAlloc(VectorElemCpy elem_copy_func, VectorElemCmp elem_cmp_func, VectorElemFree elem_free_func);
 
+/**
+ * Allocates dynamically new vector element, using the given allocator for the
+ * vector and its data (the elements are still copied by elem_copy_func).
+ * @param elem_copy_func func which copies the element stored in the vector (returns
+ * dynamically allocated copy).
+ * @param elem_cmp_func func which is used to compare elements stored in the vector.
+ * @param elem_free_func func which frees elements stored in the vector.
+ * @param allocator the allocator to use (NULL for malloc).
+ * @return pointer to dynamically allocated vector.
+ * @if_fail return NULL.
+ */
+Vector *VectorAllocWith(VectorElemCpy elem_copy_func, VectorElemCmp elem_cmp_func,
+                        VectorElemFree elem_free_func, const Allocator *allocator);
+
 /**
  * Frees a vector and the elements the vector itself allocated.
  * @param p_vector pointer to dynamically allocated pointer to vector.
@@ -115,6 +151,52 @@ int VectorFind(Vector *vector, void *value);
  */
 int VectorPushBack(Vector *vector, void *value);
 
+/**
+ * Adds the given value to the back of the vector *without* copying it.
+ * The vector takes ownership of the value (it would be freed with
+ * elem_free_func), so the caller must not free it afterwards.
+ * @param vector a pointer to vector.
+ * @param value dynamically allocated value to be moved into the vector.
+ * @return 1 if the adding has been done successfully, 0 otherwise.
+ */
+int VectorPushBackMove(Vector *vector, void *value);
+
+/**
+ * Frees a vector *without* freeing the elements stored in it.
+ * Used when the elements were moved to another owner.
+ * @param p_vector pointer to dynamically allocated pointer to vector.
+ */
+void VectorRelease(Vector **p_vector);
+
+/**
+ * Adds copies of n values to the back of the vector. The capacity is
+ * checked (and increased) once for all the values.
+ * @param vector a pointer to vector.
+ * @param elems array of n values to be added.
+ * @param n the number of values.
+ * @return 1 if all the values were added, 0 otherwise (then none is added).
+ */
+int VectorAppend(Vector *vector, void **elems, size_t n);
+
+/**
+ * Adds a copy of the value at the given index, moving the following elements
+ * once.
+ * @param vector a pointer to vector.
+ * @param ind the index of the new element ([0, vector_size]).
+ * @param value the value to be added.
+ * @return 1 if the adding has been done successfully, 0 otherwise.
+ */
+int VectorInsertAt(Vector *vector, size_t ind, void *value);
+
+/**
+ * Adds copies of all the elements of src to the back of dst (copied by the
+ * elem_copy_func of dst), like VectorAppend.
+ * @param dst a pointer to the vector to be extended.
+ * @param src a pointer to the vector whose elements are added (may be dst).
+ * @return 1 if all the elements were added, 0 otherwise (then none is added).
+ */
+int VectorExtend(Vector *dst, Vector *src);
+
 /**
  * This function returns the load factor of the vector.
  * @param vector a vector.
@@ -131,9 +213,73 @@ double VectorGetLoadFactor(Vector *vector);
 int VectorErase(Vector *vector, size_t ind);
 
 /**
- * Deletes all the elements in the vector.
+ * Removes the element at the given index from the vector *without* freeing
+ * it, and returns it (the caller owns it afterwards).
+ * @param vector a pointer to vector.
+ * @param ind the index of the element to be removed.
+ * @return the removed element, NULL for failure.
+ */
+void *VectorTakeAt(Vector *vector, size_t ind);
+
+/**
+ * Removes the elements at the indices [first, last) from the vector, moving
+ * the following elements once.
+ * @param vector a pointer to vector.
+ * @param first the index of the first element to be removed.
+ * @param last the index after the last element to be removed.
+ * @return 1 if the removing has been done successfully, 0 otherwise.
+ */
+int VectorEraseRange(Vector *vector, size_t first, size_t last);
+
+/**
+ * Removes (and frees) every element for which pred returns 1, in one pass
+ * which keeps the order of the remaining elements.
+ * @param vector a pointer to vector.
+ * @param pred a function which is called with every element and ctx.
+ * @param ctx a context passed to pred.
+ * @return the number of removed elements.
+ */
+size_t VectorRemoveIf(Vector *vector, VectorElemPred pred, void *ctx);
+
+/**
+ * Removes the element at the given index from the vector in O(1), by moving
+ * the last element to its place (so the order of the elements changes).
+ * @param vector a pointer to vector.
+ * @param ind the index of the element to be removed.
+ * @return 1 if the removing has been done successfully, 0 otherwise.
+ */
+int VectorSwapRemove(Vector *vector, size_t ind);
+
+/**
+ * Deletes all the elements in the vector (and decreases its capacity once).
  * @param vector vector a pointer to vector.
  */
 void VectorClear(Vector *vector);
 
+/**
+ * Makes room for at least n elements in the vector, so pushing up to n
+ * elements does not reallocate its data.
+ * @param vector a pointer to vector.
+ * @param n the number of elements the vector should hold.
+ * @return 1 for success, 0 otherwise.
+ */
+int VectorReserve(Vector *vector, size_t n);
+
+/**
+ * Decreases the capacity of the vector to its size (at least 1).
+ * @param vector a pointer to vector.
+ * @return 1 for success, 0 otherwise.
+ */
+int VectorShrinkToFit(Vector *vector);
+
+/**
+ * Sets the factor the capacity is multiplied by when the vector is full
+ * (VECTOR_GROWTH_FACTOR by default). Smaller factors, like 1.5, waste less
+ * memory and let allocators reuse the freed blocks.
+ * @param vector a pointer to vector.
+ * @param growth_factor the growth factor, bigger than 1.
+ * @return 1 for success, 0 otherwise.
+ */
+int VectorSetGrowthFactor(Vector *vector, double growth_factor);
+
 #endif //VECTOR_H_
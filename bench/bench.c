@@ -0,0 +1,471 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "HashMap.h"
+#include "FlatHashMap.h"
+#include "ConcurrentHashMap.h"
+#include "FlatVector.h"
+#include "TypedHashMap.h"
+#include "Hash.h"
+
+/*
+ * Benchmarks of the hot paths of Vector, HashMap, FlatHashMap, the typed
+ * HashMap_int_int and ConcurrentHashMap. Every case runs in its own process
+ * (so its peak RSS is its own) and prints one JSON line:
+ * {"bench": ..., "dist": ..., "n": ..., "hit_ratio": ..., "threads": ...,
+ *  "ns_per_op": ..., "allocs_per_op": ..., "peak_rss_kb": ...}
+ * allocs_per_op is -1 where the allocator can not be wrapped (not Linux).
+ *
+ * Usage: vector_map_bench [--min-n N] [--max-n N] [--filter SUBSTRING]
+ * The sizes are the powers of 10 in [min-n, max-n] (default 1e3 - 1e6; 1e8
+ * int pairs need tens of GB with HashMap).
+ */
+
+#define BENCH_MAX_THREADS 8
+#define BENCH_BATCH 256
+
+/*
+ * The key distributions: sequential ints, a random permutation of the ints,
+ * and multiples of a big power of 2 (all equal in the low bits, the worst
+ * case for an identity HashInt without HashFinalize).
+ */
+typedef enum KeyDist {
+  DIST_SEQ,
+  DIST_RANDOM,
+  DIST_ADVERSARIAL,
+  DIST_COUNT
+} KeyDist;
+
+static const char *DIST_NAMES[DIST_COUNT] = {"seq", "random", "adversarial"};
+
+/*
+ * A single benchmark case.
+ */
+typedef struct BenchCase {
+  const char *bench;
+  KeyDist dist;
+  size_t n;
+  double hit_ratio; // -1 when it does not apply.
+  int threads;
+} BenchCase;
+
+/*
+ * The measured part of a case.
+ */
+typedef struct BenchResult {
+  double ns;
+  size_t ops;
+  long allocs;
+} BenchResult;
+
+/*
+ * Per thread, so counting does not make the threads of the concurrent case
+ * share (and serialize on) one cache line; the workers report their counts
+ * when they finish.
+ */
+#ifdef BENCH_WRAP_MALLOC
+static __thread long alloc_count = 0;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size){
+    ++alloc_count;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size){
+    ++alloc_count;
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size){
+    ++alloc_count;
+    return __real_realloc(ptr, size);
+}
+#endif
+
+static double NowNs(void){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double) t.tv_sec * 1e9 + (double) t.tv_nsec;
+}
+
+/* The allocations of the calling thread so far. */
+static long Allocs(void){
+#ifdef BENCH_WRAP_MALLOC
+    return alloc_count;
+#else
+    return 0;
+#endif
+}
+
+/* Pair type of int keys and int values. */
+static void *IntCpy(void *value){
+    int *copy = malloc(sizeof(int));
+    if (copy) *copy = *(int *) value;
+    return copy;
+}
+
+static int IntCmp(void *value_1, void *value_2){
+    return *(int *) value_1 == *(int *) value_2;
+}
+
+static void IntFree(void **p_value){
+    free(*p_value);
+    *p_value = NULL;
+}
+
+static const PairType INT_PAIR = {IntCpy, IntCpy, IntCmp, IntCmp, IntFree, IntFree, NULL,
+                                   0, 0};
+
+static void *IntPairCpy(const void *pair){
+    return PairCopy((const Pair *) pair);
+}
+
+static int IntPairCmp(const void *pair_1, const void *pair_2){
+    const Pair *p_1 = pair_1, *p_2 = pair_2;
+    return IntCmp(p_1->key, p_2->key) && IntCmp(p_1->value, p_2->value);
+}
+
+static void IntPairFree(void **p_pair){
+    PairFree((Pair **) p_pair);
+}
+
+static size_t HashIntKey(KeyT key){
+    return HashInt(key);
+}
+
+static void *PtrCpy(const void *value){
+    return IntCpy((void *) value);
+}
+
+static int PtrCmp(const void *value_1, const void *value_2){
+    return IntCmp((void *) value_1, (void *) value_2);
+}
+
+/*
+ * The i-th key of a distribution. Keys [0, n) are inserted, keys [n, 2n)
+ * are misses; all 2n keys are distinct.
+ */
+static int KeyAt(KeyDist dist, size_t i, size_t n){
+    uint32_t x = (uint32_t) i;
+    if (dist == DIST_RANDOM){
+        // a bijection of the 32 bit ints (odd multiplications and xorshifts).
+        x *= 0x9E3779B1U;
+        x ^= x >> 16;
+        x *= 0x85EBCA6BU;
+        x ^= x >> 13;
+    }
+    else if (dist == DIST_ADVERSARIAL){
+        int shift = 31;
+        while (shift > 0 && ((uint64_t) 2 * n) > ((uint64_t) 1 << (32 - shift))) --shift;
+        x <<= shift;
+    }
+    return (int) x;
+}
+
+static int *MakeKeys(KeyDist dist, size_t n){
+    int *keys = malloc(2 * n * sizeof(int));
+    if (!keys) return NULL;
+    for (size_t i = 0; i < 2 * n; ++i) keys[i] = KeyAt(dist, i, n);
+    return keys;
+}
+
+/*
+ * The lookup keys of a case: a shuffled mix of hits and misses.
+ */
+static int *MakeLookups(const int *keys, size_t n, double hit_ratio){
+    int *lookups = malloc(n * sizeof(int));
+    if (!lookups) return NULL;
+    uint64_t state = 42;
+    for (size_t i = 0; i < n; ++i) {
+        state = HashMix64(state + i);
+        int hit = (double) (state % 1000) < hit_ratio * 1000;
+        size_t j = HashMix64(state) % n;
+        lookups[i] = hit ? keys[j] : keys[n + j];
+    }
+    return lookups;
+}
+
+static HashMap *FillHashMap(const int *keys, size_t n){
+    HashMap *map = HashMapAlloc(HashIntKey, IntPairCpy, IntPairCmp, IntPairFree);
+    for (size_t i = 0; map && i < n; ++i) {
+        int key = keys[i], value = (int) i;
+        Pair pair = {&key, &value, &INT_PAIR, 0};
+        HashMapInsert(map, &pair);
+    }
+    return map;
+}
+
+static FlatHashMap *FillFlatHashMap(const int *keys, size_t n){
+    FlatHashMap *map = FlatHashMapAlloc(HashIntKey, IntPairCpy, IntPairCmp, IntPairFree);
+    for (size_t i = 0; map && i < n; ++i) {
+        int key = keys[i], value = (int) i;
+        Pair pair = {&key, &value, &INT_PAIR, 0};
+        FlatHashMapInsert(map, &pair);
+    }
+    return map;
+}
+
+HASHMAP_DEFINE(int, int)
+
+static HashMap_int_int *FillTypedHashMap(const int *keys, size_t n){
+    HashMap_int_int *map = HashMap_int_int_Alloc();
+    for (size_t i = 0; map && i < n; ++i) HashMap_int_int_Insert(map, keys[i], keys[i]);
+    return map;
+}
+
+/* Looks the keys up with HashMapAtBatch, a request of BENCH_BATCH keys at a time. */
+static size_t BatchLookup(HashMap *map, int *lookups, size_t n){
+    KeyT keys[BENCH_BATCH];
+    ValueT values[BENCH_BATCH];
+    size_t found = 0;
+    for (size_t first = 0; first < n; first += BENCH_BATCH) {
+        size_t count = n - first < BENCH_BATCH ? n - first : BENCH_BATCH;
+        for (size_t i = 0; i < count; ++i) keys[i] = &lookups[first + i];
+        found += HashMapAtBatch(map, keys, count, values);
+    }
+    return found;
+}
+
+static int SumValues(Pair *pair, void *ctx){
+    *(long *) ctx += *(int *) pair->value;
+    return 1;
+}
+
+static volatile long sink;
+
+/* Runs the timed part of every single threaded case. */
+static BenchResult RunCase(const BenchCase *bench_case, const int *keys){
+    BenchResult result = {0, bench_case->n, 0};
+    size_t n = bench_case->n;
+    const char *name = bench_case->bench;
+    int *lookups = bench_case->hit_ratio >= 0 ? MakeLookups(keys, n, bench_case->hit_ratio) : NULL;
+    long allocs = Allocs();
+    double start = NowNs();
+    if (strcmp(name, "hashmap_insert") == 0){
+        HashMap *map = FillHashMap(keys, n);
+        result.ns = NowNs() - start;
+        result.allocs = Allocs() - allocs;
+        HashMapFree(&map);
+    }
+    else if (strcmp(name, "hashmap_at") == 0 || strcmp(name, "hashmap_at_batch") == 0 ||
+             strcmp(name, "hashmap_erase") == 0 ||
+             strcmp(name, "hashmap_clear") == 0 || strcmp(name, "hashmap_iterate") == 0){
+        HashMap *map = FillHashMap(keys, n);
+        long found = 0;
+        allocs = Allocs();
+        start = NowNs();
+        if (strcmp(name, "hashmap_at") == 0){
+            for (size_t i = 0; i < n; ++i) found += HashMapAt(map, &lookups[i]) != NULL;
+        }
+        else if (strcmp(name, "hashmap_at_batch") == 0){
+            found = (long) BatchLookup(map, lookups, n);
+        }
+        else if (strcmp(name, "hashmap_erase") == 0){
+            for (size_t i = 0; i < n; ++i) found += HashMapErase(map, (KeyT) &keys[i]);
+        }
+        else if (strcmp(name, "hashmap_clear") == 0){
+            HashMapClear(map);
+        }
+        else {
+            HashMapForEach(map, SumValues, &found);
+        }
+        result.ns = NowNs() - start;
+        result.allocs = Allocs() - allocs;
+        sink = found;
+        HashMapFree(&map);
+    }
+    else if (strcmp(name, "flathashmap_insert") == 0){
+        FlatHashMap *map = FillFlatHashMap(keys, n);
+        result.ns = NowNs() - start;
+        result.allocs = Allocs() - allocs;
+        FlatHashMapFree(&map);
+    }
+    else if (strcmp(name, "flathashmap_at") == 0){
+        FlatHashMap *map = FillFlatHashMap(keys, n);
+        long found = 0;
+        allocs = Allocs();
+        start = NowNs();
+        for (size_t i = 0; i < n; ++i) found += FlatHashMapAt(map, &lookups[i]) != NULL;
+        result.ns = NowNs() - start;
+        result.allocs = Allocs() - allocs;
+        sink = found;
+        FlatHashMapFree(&map);
+    }
+    else if (strcmp(name, "typedmap_insert") == 0){
+        HashMap_int_int *map = FillTypedHashMap(keys, n);
+        result.ns = NowNs() - start;
+        result.allocs = Allocs() - allocs;
+        HashMap_int_int_Free(&map);
+    }
+    else if (strcmp(name, "typedmap_at") == 0){
+        HashMap_int_int *map = FillTypedHashMap(keys, n);
+        long found = 0;
+        allocs = Allocs();
+        start = NowNs();
+        for (size_t i = 0; i < n; ++i) found += HashMap_int_int_At(map, lookups[i]) != NULL;
+        result.ns = NowNs() - start;
+        result.allocs = Allocs() - allocs;
+        sink = found;
+        HashMap_int_int_Free(&map);
+    }
+    else if (strcmp(name, "vector_push_back") == 0){
+        Vector *vector = VectorAlloc(PtrCpy, PtrCmp, IntFree);
+        for (size_t i = 0; vector && i < n; ++i) VectorPushBack(vector, (void *) &keys[i]);
+        result.ns = NowNs() - start;
+        result.allocs = Allocs() - allocs;
+        VectorFree(&vector);
+    }
+    else if (strcmp(name, "flatvector_push_back") == 0){
+        FlatVector *vector = FlatVectorAlloc(sizeof(int), NULL);
+        for (size_t i = 0; vector && i < n; ++i) FlatVectorPushBack(vector, &keys[i]);
+        result.ns = NowNs() - start;
+        result.allocs = Allocs() - allocs;
+        FlatVectorFree(&vector);
+    }
+    free(lookups);
+    return result;
+}
+
+/*
+ * The work of one thread of the concurrent case: insert its share of the
+ * keys, then look all of its keys up (found - the keys it found, allocs - the
+ * allocations it made; both read by the main thread after the join).
+ */
+typedef struct ConcurrentWork {
+  ConcurrentHashMap *map;
+  const int *keys;
+  size_t first;
+  size_t last;
+  long found;
+  long allocs;
+} ConcurrentWork;
+
+static void *ConcurrentWorker(void *arg){
+    ConcurrentWork *work = arg;
+    for (size_t i = work->first; i < work->last; ++i) {
+        int key = work->keys[i], value = (int) i;
+        Pair pair = {&key, &value, &INT_PAIR, 0};
+        ConcurrentHashMapInsert(work->map, &pair);
+    }
+    long found = 0;
+    for (size_t i = work->first; i < work->last; ++i) {
+        found += ConcurrentHashMapContainsKey(work->map, (KeyT) &work->keys[i]);
+    }
+    work->found = found;
+    work->allocs = Allocs();
+    return NULL;
+}
+
+/* Runs the concurrent case (2n ops: n inserts and n lookups). */
+static BenchResult RunConcurrentCase(const BenchCase *bench_case, const int *keys){
+    BenchResult result = {0, 2 * bench_case->n, 0};
+    ConcurrentHashMap *map = ConcurrentHashMapAlloc(HashIntKey, IntPairCpy, IntPairCmp,
+                                                    IntPairFree);
+    pthread_t threads[BENCH_MAX_THREADS];
+    ConcurrentWork works[BENCH_MAX_THREADS];
+    int count = bench_case->threads;
+    long allocs = Allocs();
+    double start = NowNs();
+    for (int t = 0; t < count; ++t) {
+        works[t].map = map;
+        works[t].keys = keys;
+        works[t].first = bench_case->n * t / count;
+        works[t].last = bench_case->n * (t + 1) / count;
+        pthread_create(&threads[t], NULL, ConcurrentWorker, &works[t]);
+    }
+    for (int t = 0; t < count; ++t) pthread_join(threads[t], NULL);
+    result.ns = NowNs() - start;
+    result.allocs = Allocs() - allocs;
+    long found = 0;
+    for (int t = 0; t < count; ++t) {
+        result.allocs += works[t].allocs;
+        found += works[t].found;
+    }
+    sink = found;
+    ConcurrentHashMapFree(&map);
+    return result;
+}
+
+/* Runs a case in a child process and prints its JSON line. */
+static void RunIsolated(const BenchCase *bench_case){
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0){
+        int *keys = MakeKeys(bench_case->dist, bench_case->n);
+        if (!keys) _exit(1);
+        BenchResult result = bench_case->threads > 0 ? RunConcurrentCase(bench_case, keys) :
+                             RunCase(bench_case, keys);
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+#ifdef BENCH_WRAP_MALLOC
+        double allocs_per_op = (double) result.allocs / (double) result.ops;
+#else
+        double allocs_per_op = -1;
+#endif
+        printf("{\"bench\": \"%s\", \"dist\": \"%s\", \"n\": %zu, \"hit_ratio\": %.2f, "
+               "\"threads\": %d, \"ns_per_op\": %.2f, \"allocs_per_op\": %.3f, "
+               "\"peak_rss_kb\": %ld}\n",
+               bench_case->bench, DIST_NAMES[bench_case->dist], bench_case->n,
+               bench_case->hit_ratio, bench_case->threads > 0 ? bench_case->threads : 1,
+               result.ns / (double) result.ops, allocs_per_op, usage.ru_maxrss);
+        fflush(stdout);
+        free(keys);
+        _exit(0);
+    }
+    if (pid > 0){
+        int status;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0){
+            fprintf(stderr, "%s (n=%zu) failed\n", bench_case->bench, bench_case->n);
+        }
+    }
+}
+
+int main(int argc, char **argv){
+    size_t min_n = 1000, max_n = 1000000;
+    const char *filter = NULL;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--min-n") == 0) min_n = strtoul(argv[i + 1], NULL, 10);
+        else if (strcmp(argv[i], "--max-n") == 0) max_n = strtoul(argv[i + 1], NULL, 10);
+        else if (strcmp(argv[i], "--filter") == 0) filter = argv[i + 1];
+    }
+    static const char *SIMPLE[] = {"hashmap_insert", "hashmap_erase", "hashmap_clear",
+                                   "hashmap_iterate", "flathashmap_insert", "typedmap_insert",
+                                   "vector_push_back", "flatvector_push_back"};
+    static const char *LOOKUPS[] = {"hashmap_at", "hashmap_at_batch", "flathashmap_at",
+                                    "typedmap_at"};
+    static const double HIT_RATIOS[] = {1.0, 0.5, 0.0};
+    for (size_t n = min_n; n <= max_n; n *= 10) {
+        for (int dist = 0; dist < DIST_COUNT; ++dist) {
+            BenchCase bench_case = {NULL, (KeyDist) dist, n, -1, 0};
+            for (size_t b = 0; b < sizeof(SIMPLE) / sizeof(SIMPLE[0]); ++b) {
+                bench_case.bench = SIMPLE[b];
+                if (!filter || strstr(bench_case.bench, filter)) RunIsolated(&bench_case);
+            }
+            for (size_t b = 0; b < sizeof(LOOKUPS) / sizeof(LOOKUPS[0]); ++b) {
+                for (size_t h = 0; h < sizeof(HIT_RATIOS) / sizeof(HIT_RATIOS[0]); ++h) {
+                    bench_case.bench = LOOKUPS[b];
+                    bench_case.hit_ratio = HIT_RATIOS[h];
+                    if (!filter || strstr(bench_case.bench, filter)) RunIsolated(&bench_case);
+                }
+            }
+            bench_case.hit_ratio = -1;
+            bench_case.bench = "concurrent_insert_lookup";
+            for (int threads = 1; threads <= BENCH_MAX_THREADS; threads *= 2) {
+                bench_case.threads = threads;
+                if (!filter || strstr(bench_case.bench, filter)) RunIsolated(&bench_case);
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,318 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "HashMap.h"
+#include "FlatHashMap.h"
+#include "TypedHashMap.h"
+#include "Hash.h"
+
+/*
+ * Randomized checks of the hash maps against a plain reference array, for
+ * the paths which move pairs around: the backward shift deletion of
+ * FlatHashMap and of the typed HashMap_int_int, and the incremental rehash,
+ * shrinking and value index slot fix-ups of HashMap. Meant to be run under a
+ * sanitizer (cmake -DVECTOR_MAP_SANITIZER=address).
+ *
+ * Usage: vector_map_check [--seed N] [--steps N]
+ * Prints one line per map and exits with 1 on the first mismatch.
+ */
+
+#define CHECK_KEYS 4096
+#define CHECK_VALUES 7
+#define CHECK_PHASE 20000 // steps of growing, then as many of shrinking.
+#define CHECK_FULL_EVERY 997
+#define CHECK_ABSENT (-1)
+
+/*
+ * Keys share their hash in groups of CHECK_COLLISIONS, so the probe
+ * sequences (and the buckets) are long and deletions move many pairs.
+ */
+#define CHECK_COLLISIONS 8
+#define CHECK_WEAK_HASH(key) ((size_t) ((key) / CHECK_COLLISIONS))
+#define CHECK_INT_EQ(key_1, key_2) ((key_1) == (key_2))
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)){ \
+            fprintf(stderr, "check.c:%d: %s failed\n", __LINE__, #cond); \
+            return 0; \
+        } \
+    } while (0)
+
+HASHMAP_DEFINE_WITH(int, int, CHECK_WEAK_HASH, CHECK_INT_EQ)
+
+/* Pair type of int keys and int values. */
+static void *IntCpy(void *value){
+    int *copy = malloc(sizeof(int));
+    if (copy) *copy = *(int *) value;
+    return copy;
+}
+
+static int IntCmp(void *value_1, void *value_2){
+    return *(int *) value_1 == *(int *) value_2;
+}
+
+static void IntFree(void **p_value){
+    free(*p_value);
+    *p_value = NULL;
+}
+
+static const PairType INT_PAIR = {IntCpy, IntCpy, IntCmp, IntCmp, IntFree, IntFree, NULL,
+                                   0, 0};
+
+static void *IntPairCpy(const void *pair){
+    return PairCopy((const Pair *) pair);
+}
+
+static int IntPairCmp(const void *pair_1, const void *pair_2){
+    const Pair *p_1 = pair_1, *p_2 = pair_2;
+    return IntCmp(p_1->key, p_2->key) && IntCmp(p_1->value, p_2->value);
+}
+
+static void IntPairFree(void **p_pair){
+    PairFree((Pair **) p_pair);
+}
+
+static size_t WeakHashKey(KeyT key){
+    return CHECK_WEAK_HASH(*(int *) key);
+}
+
+static size_t HashIntValue(ValueT value){
+    return HashInt(value);
+}
+
+/*
+ * The random operations: uniform in [0, bound), from a counter mixed by
+ * HashMix64 (so a seed always replays the same run).
+ */
+static uint64_t rng_state;
+
+static int RandomBelow(int bound){
+    rng_state = HashMix64(rng_state + 0x9E3779B97F4A7C15ULL);
+    return (int) (rng_state % (uint64_t) bound);
+}
+
+/* Whether the next operation inserts: mostly while growing, less while shrinking. */
+static int RandomInsert(size_t step){
+    return RandomBelow(10) < (step % (2 * CHECK_PHASE) < CHECK_PHASE ? 6 : 3);
+}
+
+static size_t RefSize(const int *ref){
+    size_t size = 0;
+    for (int key = 0; key < CHECK_KEYS; ++key) size += ref[key] != CHECK_ABSENT;
+    return size;
+}
+
+/*
+ * The Robin Hood invariant: no slot is further from its home than the slot
+ * before it plus one (so there are no holes inside a probe sequence).
+ */
+static int CheckProbeDistances(const size_t *dists, const int *used, size_t capacity){
+    for (size_t pos = 0; pos < capacity; ++pos) {
+        if (!used[pos] || dists[pos] == 0) continue;
+        size_t prev = (pos - 1) & (capacity - 1);
+        CHECK(used[prev] && dists[pos] <= dists[prev] + 1);
+    }
+    return 1;
+}
+
+static int CheckFlatSlots(FlatHashMap *map, const int *ref){
+    size_t mask = map->capacity - 1, size = 0;
+    size_t *dists = malloc(map->capacity * sizeof(size_t));
+    int *used = malloc(map->capacity * sizeof(int));
+    CHECK(dists && used);
+    for (size_t pos = 0; pos < map->capacity; ++pos) {
+        FlatHashMapSlot *slot = &map->slots[pos];
+        used[pos] = slot->pair != NULL;
+        dists[pos] = (pos - (slot->hash & mask)) & mask;
+        if (!slot->pair) continue;
+        ++size;
+        int key = *(int *) slot->pair->key;
+        CHECK(slot->hash == HashFinalize(WeakHashKey(&key)));
+        CHECK(ref[key] == *(int *) slot->pair->value);
+    }
+    int ok = CheckProbeDistances(dists, used, map->capacity);
+    free(dists);
+    free(used);
+    CHECK(ok && size == map->size && size == RefSize(ref));
+    return 1;
+}
+
+static int CheckFlatHashMap(size_t steps){
+    int ref[CHECK_KEYS];
+    for (int key = 0; key < CHECK_KEYS; ++key) ref[key] = CHECK_ABSENT;
+    FlatHashMap *map = FlatHashMapAlloc(WeakHashKey, IntPairCpy, IntPairCmp, IntPairFree);
+    CHECK(map);
+    int ok = 1;
+    for (size_t step = 0; ok && step < steps; ++step) {
+        int key = RandomBelow(CHECK_KEYS), value = RandomBelow(CHECK_VALUES);
+        if (RandomInsert(step)){
+            Pair pair = {&key, &value, &INT_PAIR, 0};
+            ok = FlatHashMapInsert(map, &pair) == 1;
+            ref[key] = value;
+        }
+        else {
+            ok = FlatHashMapErase(map, &key) == (ref[key] != CHECK_ABSENT);
+            ref[key] = CHECK_ABSENT;
+        }
+        int *found = FlatHashMapAt(map, &key);
+        ok = ok && (found ? *found == ref[key] : ref[key] == CHECK_ABSENT);
+        if (ok && step % CHECK_FULL_EVERY == 0) ok = CheckFlatSlots(map, ref);
+    }
+    ok = ok && CheckFlatSlots(map, ref);
+    FlatHashMapFree(&map);
+    CHECK(ok);
+    return 1;
+}
+
+static int CheckTypedSlots(HashMap_int_int *map, const int *ref){
+    size_t mask = map->capacity - 1, size = 0;
+    size_t *dists = malloc(map->capacity * sizeof(size_t));
+    int *used = malloc(map->capacity * sizeof(int));
+    CHECK(dists && used);
+    for (size_t pos = 0; pos < map->capacity; ++pos) {
+        HashMap_int_int_Slot *slot = &map->slots[pos];
+        used[pos] = slot->hash != TYPED_HASH_MAP_EMPTY;
+        dists[pos] = (pos - (slot->hash & mask)) & mask;
+        if (!used[pos]) continue;
+        ++size;
+        CHECK(slot->hash == HashMap_int_int_Hash(slot->key));
+        CHECK(ref[slot->key] == slot->value);
+    }
+    int ok = CheckProbeDistances(dists, used, map->capacity);
+    free(dists);
+    free(used);
+    CHECK(ok && size == HashMap_int_int_Size(map) && size == RefSize(ref));
+    return 1;
+}
+
+static int CheckTypedHashMap(size_t steps){
+    int ref[CHECK_KEYS];
+    for (int key = 0; key < CHECK_KEYS; ++key) ref[key] = CHECK_ABSENT;
+    HashMap_int_int *map = HashMap_int_int_Alloc();
+    CHECK(map);
+    int ok = 1;
+    for (size_t step = 0; ok && step < steps; ++step) {
+        int key = RandomBelow(CHECK_KEYS), value = RandomBelow(CHECK_VALUES);
+        if (RandomInsert(step)){
+            ok = HashMap_int_int_Insert(map, key, value) == 1;
+            ref[key] = value;
+        }
+        else {
+            ok = HashMap_int_int_Erase(map, key) == (ref[key] != CHECK_ABSENT);
+            ref[key] = CHECK_ABSENT;
+        }
+        int *found = HashMap_int_int_At(map, key);
+        ok = ok && (found ? *found == ref[key] : ref[key] == CHECK_ABSENT);
+        if (ok && step % CHECK_FULL_EVERY == 0) ok = CheckTypedSlots(map, ref);
+    }
+    ok = ok && CheckTypedSlots(map, ref);
+    HashMap_int_int_Free(&map);
+    CHECK(ok);
+    return 1;
+}
+
+static int CountPair(Pair *pair, void *ctx){
+    (void) pair;
+    ++*(size_t *) ctx;
+    return 1;
+}
+
+/*
+ * Every key (also through the old buckets while migrating), the size, the
+ * iteration and the value index (counts and reverse lookups) of the map.
+ */
+static int CheckHashMapContents(HashMap *map, const int *ref){
+    CHECK(map->size == RefSize(ref));
+    for (int key = 0; key < CHECK_KEYS; ++key) {
+        int *found = HashMapAt(map, &key);
+        CHECK(found ? *found == ref[key] : ref[key] == CHECK_ABSENT);
+    }
+    size_t visited = 0;
+    CHECK(HashMapForEach(map, CountPair, &visited) && visited == map->size);
+    CHECK(map->value_index);
+    for (int value = 0; value < CHECK_VALUES; ++value) {
+        size_t count = 0;
+        for (int key = 0; key < CHECK_KEYS; ++key) count += ref[key] == value;
+        CHECK(HashMapCountValue(map, &value) == count);
+        int *key = HashMapKeyOf(map, &value);
+        CHECK(count ? key && ref[*key] == value : !key);
+    }
+    return 1;
+}
+
+/* One random operation on the map and the reference; 1 if they agree. */
+static int HashMapStep(HashMap *map, int *ref, size_t step){
+    int key = RandomBelow(CHECK_KEYS), value = RandomBelow(CHECK_VALUES);
+    int op = RandomBelow(100);
+    if (RandomInsert(step)){
+        Pair pair = {&key, &value, &INT_PAIR, 0};
+        CHECK(HashMapInsert(map, &pair));
+        ref[key] = value;
+    }
+    else if (op < 40){
+        CHECK(HashMapErase(map, &key) == (ref[key] != CHECK_ABSENT));
+        ref[key] = CHECK_ABSENT;
+    }
+    else if (op < 60){
+        Pair *pair = HashMapEraseAndGet(map, &key);
+        CHECK(pair ? *(int *) pair->value == ref[key] : ref[key] == CHECK_ABSENT);
+        PairFree(&pair);
+        ref[key] = CHECK_ABSENT;
+    }
+    else if (op < 95){
+        CHECK(HashMapUpdateValue(map, &key, &value) == (ref[key] != CHECK_ABSENT));
+        if (ref[key] != CHECK_ABSENT) ref[key] = value;
+    }
+    else if (op < 97){
+        // finishes a migration; the next growth migrates incrementally again.
+        CHECK(HashMapSetIncrementalRehash(map, 0) && !map->old_buckets);
+        CHECK(HashMapSetIncrementalRehash(map, 1));
+    }
+    else if (op < 99){
+        CHECK(HashMapShrinkToFit(map));
+    }
+    else {
+        CHECK(HashMapReserve(map, map->size + (size_t) RandomBelow(CHECK_KEYS)));
+    }
+    int *found = HashMapAt(map, &key);
+    CHECK(found ? *found == ref[key] : ref[key] == CHECK_ABSENT);
+    return 1;
+}
+
+static int CheckHashMap(size_t steps){
+    int ref[CHECK_KEYS];
+    for (int key = 0; key < CHECK_KEYS; ++key) ref[key] = CHECK_ABSENT;
+    HashMap *map = HashMapAlloc(WeakHashKey, IntPairCpy, IntPairCmp, IntPairFree);
+    CHECK(map);
+    HashMapSetShrinkPolicy(map, HASH_MAP_SHRINK_HYSTERESIS);
+    int ok = HashMapSetIncrementalRehash(map, 1) && HashMapSetValueIndex(map, HashIntValue);
+    for (size_t step = 0; ok && step < steps; ++step) {
+        ok = HashMapStep(map, ref, step);
+        if (ok && step % CHECK_FULL_EVERY == 0) ok = CheckHashMapContents(map, ref);
+    }
+    ok = ok && CheckHashMapContents(map, ref);
+    HashMapFree(&map);
+    CHECK(ok);
+    return 1;
+}
+
+int main(int argc, char **argv){
+    unsigned long seed = 1;
+    size_t steps = 200000;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--seed") == 0) seed = strtoul(argv[i + 1], NULL, 10);
+        else if (strcmp(argv[i], "--steps") == 0) steps = strtoul(argv[i + 1], NULL, 10);
+    }
+    static const char *NAMES[] = {"flathashmap", "typedmap", "hashmap"};
+    static int (*const CHECKS[])(size_t) = {CheckFlatHashMap, CheckTypedHashMap,
+                                            CheckHashMap};
+    int failed = 0;
+    for (size_t c = 0; c < sizeof(CHECKS) / sizeof(CHECKS[0]); ++c) {
+        rng_state = seed;
+        int ok = CHECKS[c](steps);
+        printf("%s: %s (seed %lu, %zu steps)\n", NAMES[c], ok ? "ok" : "FAILED", seed, steps);
+        failed |= !ok;
+    }
+    return failed;
+}